@@ -1,9 +1,11 @@
 #pragma once
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <atlbase.h>
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include "../StateStream.h"
 
 using namespace DirectX;
 
@@ -21,23 +23,43 @@ enum ComponentType {
 	COMPONENT_ANIMATION = 1 << 9,
 	COMPONENT_EMITTER = 1 << 10
 };
+constexpr size_t COMPONENT_TYPE_COUNT = 11;
+
+//Bit position of a single component type, used to index per-type arrays.
+constexpr size_t componentIndex(const ComponentType type) {
+	size_t index = 0;
+	for (uint32_t bits = static_cast<uint32_t>(type); bits > 1; bits >>= 1) ++index;
+	return index;
+}
 
 class Entity;
+class ChangeQueue;
 class AComponent : public std::enable_shared_from_this<AComponent> {
 	friend Entity;
+	friend ChangeQueue;
 private:
 	ComponentType _type;
 	std::vector<std::weak_ptr<AComponent>> _observers;
+	std::atomic<bool> _changed;
+	//When this last changed, and when it was last told about a change as an observer, see ChangeQueue::flush.
+	std::atomic<uint64_t> _changeStamp;
+	uint64_t _deliveryStamp;
+
+	void deliverChanges(const uint64_t stamp);
 public:
 	AComponent(ComponentType type);
-	virtual ~AComponent() {};
+	virtual ~AComponent();
 	AComponent(const AComponent&);
 	AComponent& operator=(const AComponent&);
 	AComponent(AComponent&&);
 	AComponent& operator=(AComponent&&);
 
+	//Marks this component changed, observers are told once when the ChangeQueue is flushed.
 	void notify();
 	virtual void onAwake(Entity& e, const CComPtr<ID3D11Device>& device) = 0;
+	//Simulation state for snapshots/rewind, components without any keep the no-op default.
+	virtual void saveState(StateWriter& writer) const {}
+	virtual void loadState(StateReader& reader) {}
 	void addObserver(const std::weak_ptr<AComponent> observer);
 	void removeObserver(const std::weak_ptr<AComponent> observer);
 	const ComponentType getType() const { return _type; }
@@ -2,22 +2,56 @@
 #include <vector>
 #include <string>
 #include "../Entity.h"
+#include "../ArchetypeStore.h"
+#include "../EntityRegistry.h"
+#include "../CommandBuffer.h"
 #include "../Components/AComponent.h"
 
 class ASystem {
 private:
 	ComponentType _mask;
+	EntityQuery& _query;
+	uint16_t _reads, _writes;
+	size_t _splitGrain;
+	CommandBuffer _commandBuffer;
 protected:
-	std::vector<std::weak_ptr<Entity>> _entities;
+	//Maintained by the EntityRegistry, entities join/leave as their masks change.
+	const std::vector<EntityHandle>& _entities;
 	const inline ComponentType& getMask() const { return _mask; }
-	inline std::vector<std::weak_ptr<Entity>>& getMutEntities() { return _entities; }
-	const inline std::vector<std::weak_ptr<Entity>>& getEntities() const { return _entities; }
+	const inline std::vector<EntityHandle>& getEntities() const { return _entities; }
+	inline Entity* resolve(const EntityHandle handle) const { return EntityRegistry::getInstance().get(handle); }
+	//Structural changes made during onAction must go through here, they apply at the next sync point.
+	inline CommandBuffer& commands() { return _commandBuffer; }
+	//Visits every archetype matching this system's mask, see Archetype::column.
+	template <class Fn>
+	void forEachArchetype(Fn&& fn) const { _query.forEachArchetype(std::forward<Fn>(fn)); }
 	ASystem(const ComponentType mask);
+	//Undeclared systems are assumed to read and write everything and so never overlap another.
+	void declareAccess(const uint16_t reads, const uint16_t writes) { _reads = reads; _writes = writes; }
+	//Lets the scheduler hand onActionRange chunks of _entities to several threads instead of calling onAction.
+	void setSplit(const size_t grain) { _splitGrain = grain; }
 public:
-	virtual ~ASystem() = default;
+	virtual ~ASystem();
 	ASystem(const ASystem&) = delete;
 	ASystem operator=(const ASystem&) = delete;
 
-	virtual void onInit(const std::vector<std::shared_ptr<Entity>>&) = 0;
+	virtual void onInit(const std::vector<EntityHandle>&) = 0;
 	virtual void onAction() = 0;
+	virtual void onActionRange(const size_t begin, const size_t end) {}
+	virtual void onEntityAdded(const EntityHandle) {}
+	virtual void onEntityRemoved(const EntityHandle) {}
+	//Entity stayed in the query but gained/lost components outside the query mask.
+	virtual void onComponentsChanged(const EntityHandle, const uint16_t added, const uint16_t removed) {}
+	//Simulation state outside components (e.g. physics velocities) for snapshots/rewind.
+	virtual void saveState(StateWriter& writer) const {}
+	virtual void loadState(StateReader& reader) {}
+
+	const inline uint16_t getReads() const { return _reads; }
+	const inline uint16_t getWrites() const { return _writes; }
+	const inline size_t getSplit() const { return _splitGrain; }
+	const inline size_t getEntityCount() const { return _entities.size(); }
+	inline CommandBuffer& getCommandBuffer() { return _commandBuffer; }
+	const inline bool conflictsWith(const ASystem& other) const {
+		return (_writes & (other._reads | other._writes)) != 0 || (other._writes & _reads) != 0;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+struct AllocationStats {
+	size_t heapAllocations = 0;
+	size_t heapBytes = 0;
+	size_t poolAllocations = 0;
+	size_t poolReuses = 0;
+};
+
+//Counts allocations per frame. Heap counts come from a global operator new replacement
+//that is only compiled with TRACK_ALLOCATIONS defined; pool counts are always on.
+class AllocationCounter final
+{
+private:
+	static std::atomic<size_t> _heapAllocations, _heapBytes, _poolAllocations, _poolReuses;
+	static AllocationStats _lastFrame;
+	static AllocationStats _frameStart;
+	static AllocationStats snapshot();
+public:
+	AllocationCounter() = delete;
+
+	static void onHeapAllocation(const size_t bytes) { ++_heapAllocations; _heapBytes += bytes; }
+	static void onPoolAllocation(const bool reused) { ++_poolAllocations; if (reused) ++_poolReuses; }
+	//Closes the previous frame's window, call once at the top of the frame loop.
+	static void beginFrame();
+	static const AllocationStats& lastFrame() { return _lastFrame; }
+	static AllocationStats total() { return snapshot(); }
+};
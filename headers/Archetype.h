@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <vector>
+#include "Components/AComponent.h"
+#include "Components/ComponentTraits.h"
+
+class Entity;
+
+//Groups every entity sharing a component mask. Each component type in the mask
+//owns one column, so a system can walk all entities of an archetype linearly.
+class Archetype {
+private:
+	uint16_t _mask;
+	std::array<int8_t, COMPONENT_TYPE_COUNT> _columnIndex;
+	std::vector<std::vector<AComponent*>> _columns;
+	std::vector<Entity*> _entities;
+public:
+	Archetype(const uint16_t mask);
+	~Archetype() = default;
+	Archetype(const Archetype&) = delete;
+	Archetype& operator=(const Archetype&) = delete;
+
+	size_t push(Entity& e);
+	Entity* swapRemove(const size_t row);
+	void reserve(const size_t extra);
+
+	const inline uint16_t getMask() const { return _mask; }
+	const inline size_t size() const { return _entities.size(); }
+	const inline bool empty() const { return _entities.empty(); }
+	const inline bool has(const ComponentType type) const { return (_mask & type) == type; }
+	const inline std::vector<Entity*>& getEntities() const { return _entities; }
+	const inline std::vector<AComponent*>& column(const ComponentType type) const { return _columns[_columnIndex[componentIndex(type)]]; }
+	template <class T>
+	T* get(const size_t row) const { return static_cast<T*>(_columns[_columnIndex[ComponentTraits<T>::index]][row]); }
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include "Archetype.h"
+
+class ArchetypeStore final
+{
+private:
+	ArchetypeStore() = default;
+	std::unordered_map<uint16_t, std::unique_ptr<Archetype>> _archetypes;
+	std::vector<Archetype*> _ordered;
+
+	Archetype& findOrCreate(const uint16_t mask);
+public:
+	~ArchetypeStore() = default;
+	ArchetypeStore(const ArchetypeStore&) = delete;
+	ArchetypeStore& operator=(const ArchetypeStore&) = delete;
+
+	static ArchetypeStore& getInstance() {
+		static ArchetypeStore instance;
+		return instance;
+	}
+	void onMaskChanged(Entity& e);
+	void remove(Entity& e);
+	void reserve(const uint16_t mask, const size_t extra) { if (mask != 0) findOrCreate(mask).reserve(extra); }
+	const inline std::vector<Archetype*>& getArchetypes() const { return _ordered; }
+
+	//Calls fn once per non-empty archetype whose mask contains every bit of mask.
+	template <class Fn>
+	void forEach(const uint16_t mask, Fn&& fn) const {
+		for (auto* archetype : _ordered)
+			if ((archetype->getMask() & mask) == mask && !archetype->empty())
+				fn(*archetype);
+	}
+};
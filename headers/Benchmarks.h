@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct BenchmarkResult {
+	std::string name;
+	size_t count;
+	//Best of the repeats, so one-off stalls don't skew the number.
+	double nanosecondsPerItem;
+};
+
+//Microbenchmarks for the hot ECS and transform paths. They create their own entities
+//through the registry, so run them before any system registers a query.
+namespace Benchmarks {
+	//Hashed getComponent<T>().lock() versus the typed slot lookup get<T>() over entityCount entities.
+	std::vector<BenchmarkResult> componentLookup(const size_t entityCount, const size_t repeats);
+	//computeDrawMatrices over count world matrices, once per SIMD path this CPU supports.
+	std::vector<BenchmarkResult> drawMatrices(const size_t count, const size_t repeats);
+	//One line per result, e.g. for OutputDebugStringA.
+	std::string format(const std::vector<BenchmarkResult>& results);
+}
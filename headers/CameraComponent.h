@@ -4,9 +4,10 @@
 class CameraComponent : public AComponent {
 private:
 	XMFLOAT4X4 _view, _projection;
-	XMFLOAT3 _pos, _lookAt, _up, _offset;
+	XMFLOAT3 _pos, _lookAt, _up;
 	float _fov, _near, _far;
 	std::shared_ptr<TransformComponent> _parent;
+	std::weak_ptr<TransformComponent> _transform;
 public:
 	CameraComponent();
 	CameraComponent(XMFLOAT3 lookAt = XMFLOAT3(0,0,0), XMFLOAT3 up = XMFLOAT3(0, 1, 0), float fov = XM_PIDIV2, float nearPlane = 0.01f, float farPlane = 100.0f);
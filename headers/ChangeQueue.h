@@ -0,0 +1,34 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+class AComponent;
+
+//Collects components that called notify() this frame. Each component is queued once
+//however often it changes, and observers hear about it when flush() runs before render.
+//An observer of several changed components is only called again for changes made after it last ran.
+class ChangeQueue final
+{
+private:
+	ChangeQueue() = default;
+	std::vector<AComponent*> _changed;
+	std::atomic<uint64_t> _stamp{ 0 };
+	std::mutex _lock;
+public:
+	~ChangeQueue() = default;
+	ChangeQueue(const ChangeQueue&) = delete;
+	ChangeQueue& operator=(const ChangeQueue&) = delete;
+
+	static ChangeQueue& getInstance() {
+		static ChangeQueue instance;
+		return instance;
+	}
+	void push(AComponent* component);
+	void remove(AComponent* component);
+	//Orders changes against deliveries, never 0.
+	uint64_t nextStamp() { return ++_stamp; }
+	//Components queued by observers during the flush are delivered in the same flush.
+	void flush();
+};
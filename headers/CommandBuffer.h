@@ -0,0 +1,48 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <d3d11.h>
+#include <atlbase.h>
+#include "EntityHandle.h"
+#include "Components/AComponent.h"
+
+//Records structural changes (create/destroy/add/remove component) made while systems
+//iterate, so nothing they are walking moves underneath them. Buffers are played back
+//together at the frame's sync point, see playback.
+class CommandBuffer {
+private:
+	enum class CommandType : uint8_t {
+		Create,
+		Destroy,
+		AddComponent,
+		RemoveComponent
+	};
+	struct Command {
+		CommandType type;
+		EntityHandle target;
+		ComponentType componentType;
+		std::shared_ptr<AComponent> component;
+		std::string name;
+	};
+	std::vector<Command> _commands;
+	std::mutex _recordLock;
+public:
+	CommandBuffer() = default;
+	~CommandBuffer() = default;
+	CommandBuffer(const CommandBuffer&) = delete;
+	CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+	//The returned handle can be used in later commands straight away, it resolves after playback.
+	EntityHandle create(const char* name);
+	void destroy(const EntityHandle e);
+	//Create components with makeComponent so they come from the scene arena.
+	void addComponent(const EntityHandle e, const std::shared_ptr<AComponent> component);
+	void removeComponent(const EntityHandle e, const ComponentType type);
+	const inline bool empty() const { return _commands.empty(); }
+
+	//Applies every buffer in one pass. Commands are folded per entity, then entities are
+	//applied grouped by destination archetype so each one moves at most once.
+	static void playback(const std::vector<CommandBuffer*>& buffers, const CComPtr<ID3D11Device>& device);
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "AComponent.h"
+
+class TransformComponent;
+class GeometryComponent;
+class TextureComponent;
+class RenderComponent;
+class TerrainComponent;
+class ShaderComponent;
+class CameraComponent;
+class LightComponent;
+class EmitterComponent;
+
+//Maps a concrete component class to its ComponentType bit at compile time,
+//letting Entity/Archetype hand out typed pointers without RTTI.
+template <class T>
+struct ComponentTraits;
+
+#define DECLARE_COMPONENT_TRAITS(T, TYPE) \
+	template <> struct ComponentTraits<T> { \
+		static constexpr ComponentType type = TYPE; \
+		static constexpr size_t index = componentIndex(TYPE); \
+	}
+
+DECLARE_COMPONENT_TRAITS(TransformComponent, COMPONENT_TRANSFORM);
+DECLARE_COMPONENT_TRAITS(GeometryComponent, COMPONENT_GEOMETRY);
+DECLARE_COMPONENT_TRAITS(TextureComponent, COMPONENT_TEXTURE);
+DECLARE_COMPONENT_TRAITS(RenderComponent, COMPONENT_RENDER);
+DECLARE_COMPONENT_TRAITS(TerrainComponent, COMPONENT_TERRAIN);
+DECLARE_COMPONENT_TRAITS(ShaderComponent, COMPONENT_SHADER);
+DECLARE_COMPONENT_TRAITS(CameraComponent, COMPONENT_CAMERA);
+DECLARE_COMPONENT_TRAITS(LightComponent, COMPONENT_LIGHT);
+DECLARE_COMPONENT_TRAITS(EmitterComponent, COMPONENT_EMITTER);
+
+#undef DECLARE_COMPONENT_TRAITS
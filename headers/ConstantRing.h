@@ -0,0 +1,57 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include "GraphicsContext.h"
+#include "GraphicsDevice.h"
+
+//Where an allocation landed, ready for *SetConstantBuffers1.
+struct ConstantSlice {
+	GraphicsBuffer* buffer;
+	uint32_t firstConstant;
+	uint32_t numConstants;
+};
+
+//One large dynamic constant buffer that per-draw constants are sub-allocated from at 256 byte
+//offsets. Writes use MAP_WRITE_NO_OVERWRITE, so the driver never renames it; instead each frame
+//ends with an event query, and an allocation that would wrap onto a frame the GPU hasn't
+//finished waits for that frame's query.
+//A ring for a deferred context is created with no frames in flight: deferred contexts can't
+//wait on queries, and the first map in each command list has to discard anyway, so it renames
+//the buffer with a discard whenever it fills up or a new list starts.
+class ConstantRing {
+private:
+	//D3D11.1 offsets are in 16 constants of 16 bytes
+	static constexpr size_t ALIGNMENT = 256;
+
+	struct Frame {
+		GraphicsQuery* fence;
+		size_t end;
+	};
+
+	GraphicsRef<GraphicsBuffer> _buffer;
+	std::vector<GraphicsRef<GraphicsQuery>> _fences;
+	std::deque<Frame> _inFlight;
+	size_t _nextFence = 0;
+	size_t _size = 0;
+	//Running byte totals, the ring position is written % size and in flight is written - retired
+	size_t _written = 0, _retired = 0;
+	bool _discardNext = true;
+	size_t _waits = 0;
+
+	void retire(GraphicsContext& ctx, const bool wait);
+public:
+	//False (and unavailable) when the device can't bind constant buffers at offsets, callers
+	//then stay on whole buffers. Zero frames in flight makes a deferred context's ring.
+	bool create(GraphicsDevice* device, const size_t size, const size_t framesInFlight);
+	const inline bool isAvailable() const { return _buffer != nullptr; }
+	//Deferred rings only, call before recording each command list.
+	void discard() { _written = _retired = 0; _discardNext = true; }
+
+	//Frees what the GPU has finished with, call at the top of the frame.
+	void beginFrame(GraphicsContext& ctx);
+	//Fences everything allocated this frame, call after Present.
+	void endFrame(GraphicsContext& ctx);
+	ConstantSlice allocate(const void* data, const size_t size, GraphicsContext& ctx);
+	//Times an allocation or frame had to stall on the GPU.
+	const inline size_t getWaitCount() const { return _waits; }
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include "Utility.h"
+#include "GraphicsContext.h"
+
+//Forwards straight to an immediate or deferred ID3D11DeviceContext.
+class D3D11GraphicsContext : public GraphicsContext {
+private:
+	CComPtr<ID3D11DeviceContext> _context;
+	//Null before D3D11.1, offset binds then fall back to binding the whole buffer
+	CComPtr<ID3D11DeviceContext1> _context1;
+public:
+	D3D11GraphicsContext(const CComPtr<ID3D11DeviceContext>& context);
+
+	void clearRenderTarget(GraphicsRenderTarget* rtv, const float colour[4]) override { _context->ClearRenderTargetView(rtv, colour); }
+	void clearDepthStencil(GraphicsDepthStencil* dsv, const uint32_t flags, const float depth, const uint8_t stencil) override { _context->ClearDepthStencilView(dsv, flags, depth, stencil); }
+	void setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv) override { _context->OMSetRenderTargets(count, rtvs, dsv); }
+	GraphicsDepthStencil* getBoundDepthStencil() override;
+	void setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override { _context->VSSetConstantBuffers(slot, count, buffers); }
+	void setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override { _context->PSSetConstantBuffers(slot, count, buffers); }
+	void setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override { _context->VSSetShaderResources(slot, count, srvs); }
+	void setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override { _context->PSSetShaderResources(slot, count, srvs); }
+	void setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override { _context->IASetVertexBuffers(slot, count, buffers, strides, offsets); }
+	void setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset) override { _context->IASetIndexBuffer(buffer, static_cast<DXGI_FORMAT>(format), offset); }
+	void setRasterizerState(GraphicsRasterizerState* state) override { _context->RSSetState(state); }
+	void setViewports(const uint32_t count, const GraphicsViewport* viewports) override { _context->RSSetViewports(count, reinterpret_cast<const D3D11_VIEWPORT*>(viewports)); }
+	void setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask) override { _context->OMSetBlendState(state, factor, mask); }
+	void setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef) override { _context->OMSetDepthStencilState(state, stencilRef); }
+	void setPixelShader(GraphicsPixelShader* shader) override { _context->PSSetShader(shader, nullptr, 0); }
+	void draw(const uint32_t vertexCount, const uint32_t startVertex) override { _context->Draw(vertexCount, startVertex); }
+	void drawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex) override { _context->DrawIndexed(indexCount, startIndex, baseVertex); }
+	void drawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance) override {
+		_context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+	void copyResource(GraphicsResource* destination, GraphicsResource* source) override { _context->CopyResource(destination, source); }
+	void generateMips(GraphicsShaderResource* srv) override { _context->GenerateMips(srv); }
+	void updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size) override;
+	void writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard) override;
+	void endQuery(GraphicsQuery* query) override { _context->End(query); }
+	bool isQueryDone(GraphicsQuery* query, const bool flush) override { return _context->GetData(query, nullptr, 0, flush ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK; }
+	void finishCommandList(GraphicsCommandList** commands) override;
+	//Restores the immediate state afterwards, so passes around a parallel one don't need to re-bind
+	void executeCommandList(GraphicsCommandList* commands) override { _context->ExecuteCommandList(commands, TRUE); }
+	bool present(GraphicsSwapChain* swapChain) override { return SUCCEEDED(swapChain->Present(0, 0)); }
+	NativeContext* getNative() override { return _context.p; }
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include "Utility.h"
+#include "GraphicsDevice.h"
+
+//Creates resources on an ID3D11Device, refs release them when the last one goes.
+class D3D11GraphicsDevice : public GraphicsDevice {
+private:
+	CComPtr<ID3D11Device> _device;
+public:
+	D3D11GraphicsDevice(const CComPtr<ID3D11Device>& device) : _device(device) {}
+
+	GraphicsRef<GraphicsBuffer> createConstantBuffer(const size_t size) override;
+	bool createStructuredBuffer(const size_t stride, const size_t count, GraphicsRef<GraphicsBuffer>& buffer, GraphicsRef<GraphicsShaderResource>& srv) override;
+	bool createRenderTexture(const uint32_t width, const uint32_t height, const GraphicsFormat format, const bool mips,
+		GraphicsRef<GraphicsTexture>& texture, GraphicsRef<GraphicsRenderTarget>& rtv, GraphicsRef<GraphicsShaderResource>& srv) override;
+	GraphicsRef<GraphicsQuery> createEventQuery() override;
+	bool supportsConstantOffsets() override;
+	const inline CComPtr<ID3D11Device>& getNative() const { return _device; }
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Utility.h"
+#include "GraphicsContext.h"
+#include "FilteringGraphicsContext.h"
+#include "ConstantRing.h"
+#include "FunctionRef.h"
+
+//A set of deferred contexts that record slices of a pass across the ThreadPool, the command
+//lists then play back in slice order on the immediate context. Each context has its own bind
+//filter and constant ring, so slices share nothing while recording.
+class DeferredRecorder {
+public:
+	struct Context {
+		size_t index;
+		std::shared_ptr<FilteringGraphicsContext> gfx;
+		ConstantRing ring;
+		CComPtr<ID3D11CommandList> commands;
+	};
+private:
+	std::vector<std::unique_ptr<Context>> _contexts;
+	//Immediate state set up outside the renderer, deferred contexts start from defaults instead
+	D3D11_VIEWPORT _viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+	UINT _viewportCount = 0;
+	D3D11_PRIMITIVE_TOPOLOGY _topology;
+	CComPtr<ID3D11RasterizerState> _rasterizer;
+	CComPtr<ID3D11SamplerState> _vsSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT], _psSamplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	size_t _commandLists = 0;
+
+	void captureState(GraphicsContext& immediate);
+	void inheritState(Context& context);
+public:
+	//One context per thread that can record at once, none if the device has no deferred contexts.
+	void create(ID3D11Device* device, const size_t count, const size_t ringSize);
+	const inline size_t size() const { return _contexts.size(); }
+
+	//Splits [0, count) into slices in order and runs fn(context, begin, end) for each on its own
+	//deferred context, then executes them on immediate. At most size() slices.
+	void record(GraphicsContext& immediate, const size_t count, const size_t slices, FunctionRef<void(Context&, size_t, size_t)> fn);
+	//Command lists executed since creation.
+	const inline size_t getCommandListCount() const { return _commandLists; }
+};
@@ -1,33 +1,111 @@
 #pragma once
+#include <unordered_map>
 #include "ASystem.h"
-#include "../RenderTarget.h"
 #include "../ShadowMap.h"
-#include "../GBuffer.h"
 #include "../Timer.h"
 #include "../Utility.h"
+#include "../TransformKernels.h"
+#include "../TrackedCBuffer.h"
+#include "../GraphicsContext.h"
+#include "../GraphicsDevice.h"
+#include "../RenderGraph.h"
+#include "../FilteringGraphicsContext.h"
+#include "../DrawSort.h"
+#include "../StructuredBuffer.h"
+#include "../ConstantRing.h"
+#include "../DeferredRecorder.h"
+#include "../FunctionRef.h"
+#include "../Frustum.h"
 #include "../Managers/DirectX11Manager.h"
 #include "../Components/ShaderComponent.h"
 
+class GeometryComponent;
+struct TerrainChunk;
+
+//Full screen quad entities, in the order the scene file declares them.
+enum class ScreenPass {
+	Light,
+	Blur,
+	Final,
+	Bright
+};
+
+//Copy of a shadow map holding only static casters, restored each frame instead of redrawing them.
+struct ShadowCache {
+	CComPtr<ID3D11Texture2D> depth, staticLayer;
+	XMFLOAT4X4 viewProj;
+	bool valid = false;
+	//Light-space centre and half size the map is held at while the camera slice stays inside it (w is 0 until
+	//the first fit), and its near plane
+	XMFLOAT4 fit = XMFLOAT4(0, 0, 0, 0);
+	float nearZ = 0;
+};
+
+//A run of sorted draws sharing a mesh, shader and textures. Only the geometry pass makes runs longer than one.
+//More than one is drawn instanced, reading InstanceTransform from instanceBase on, see setInstancing.
+struct DrawBatch {
+	size_t begin, count;
+	UINT instanceBase;
+};
+
+//Per-draw constants one recording thread writes, so slices recorded in parallel never share _cDrawBuffer.
+struct DrawState {
+	DrawFrameBuffer constants;
+	TrackedCBuffer<DrawFrameBuffer> buffer;
+	//For transforms not in the hierarchy yet
+	DrawMatrices scratch;
+};
+
 class DirectX11Renderer : public ASystem {
 private:
-	std::vector<std::weak_ptr<Entity>> _lights;
-	std::vector<std::shared_ptr<Entity>> _passes;
-	std::vector<std::weak_ptr<Entity>> _particleSystems;
+	//VS t1, slot 0 is the displacement map
+	static constexpr UINT INSTANCE_SLOT = 1;
+	//256 bytes a draw, room for several thousand draws a frame with 3 frames in flight
+	static constexpr size_t CONSTANT_RING_SIZE = 4 * 1024 * 1024;
+	//Each deferred context's ring only has to hold one slice, it renames itself when full
+	static constexpr size_t DEFERRED_RING_SIZE = 1024 * 1024;
+	//Fewer draws than this a slice and the command list costs more than recording saves
+	static constexpr size_t MIN_SLICE_DRAWS = 128;
+	static constexpr UINT MAX_BLOOM_LEVELS = 8;
+	//Bloom is only ever added on top of the lit scene, it doesn't need alpha or full float precision
+	static constexpr DXGI_FORMAT BLOOM_FORMAT = DXGI_FORMAT_R11G11B10_FLOAT;
+
+	EntityQuery& _lights;
+	EntityQuery& _passes;
+	EntityQuery& _particleSystems;
 	CComPtr<IDXGISwapChain> _swapChain = nullptr;
 	CComPtr<ID3D11Device> _device = nullptr;
 	CComPtr<ID3D11DeviceContext> _context = nullptr;
+	std::shared_ptr<GraphicsContext> _gfx;
+	std::shared_ptr<GraphicsDevice> _graphicsDevice;
+	std::shared_ptr<FilteringGraphicsContext> _stateFilter;
 	CComPtr<ID3D11RenderTargetView> _renderTargetView = nullptr;
 	CComPtr<ID3D11DepthStencilView> _depthStencilView = nullptr;
 	CComPtr<ID3D11ShaderResourceView> _depthStencilSRV = nullptr;
 	CComPtr<ID3D11DepthStencilState> _depthDisabledState = nullptr;
 	CComPtr<ID3D11RasterizerState> _rasterState, _rasterState_QUAD, _rasterState_WIRE;
-	CComPtr<ID3D11Buffer> _gcUpdateBuffer, _gcDrawBuffer, _gcRenderStateCBuffer, 
-		_gcVPBuffer, _gcLightBuffer, _gcBlurPassBuffer, _gcParticleBuffer, _gcMRTBuffer;
-	RenderTarget _lightPassOutput, _blurPassOutput, _brightPassOutput;
+	TrackedCBuffer<UpdateFrameBuffer> _gcUpdateBuffer;
+	TrackedCBuffer<DrawFrameBuffer> _gcDrawBuffer;
+	TrackedCBuffer<MiscCBuffer> _gcRenderStateCBuffer, _gcBlurPassBuffer, _gcMRTBuffer;
+	TrackedCBuffer<ViewProjBuffer> _gcVPBuffer;
+	TrackedCBuffer<LightCBuffer> _gcLightBuffer;
+	TrackedCBuffer<ParticleBuffer> _gcParticleBuffer;
+	ConstantRing _constantRing;
+	DeferredRecorder _recorder;
+	//0 records on the immediate context, n + 1 on deferred context n
+	std::vector<DrawState> _drawStates;
+	bool _parallelSubmission = true;
+	bool _instancing = false;
+	RenderGraph _graph;
+	RGResource _rgAlbedo, _rgNormal, _rgHDR, _rgDepth, _rgSunDepth, _rgMoonDepth, _rgLit, _rgBright, _rgComposite;
+	//Level n is 1 / 2^(n + 1) of the screen, H holds each level's horizontal blur
+	std::vector<RGResource> _rgBloom, _rgBloomH;
+	UINT _bloomLevels = 5;
+	CComPtr<ID3D11BlendState> _additiveBlendState;
 
 	std::unique_ptr<ShadowMap> _sunlight, _moonlight;
-	GBuffer _gbuffer;
-	UINT width, height;
+	GBufferLayout _gbufferLayout;
+	UINT width = 0, height = 0;
 	RENDER_MODE _renderMode;
 	MRT_MODE _mrtMode;
 	LightCBuffer _cLightBuffer;
@@ -36,30 +114,144 @@ private:
 	MiscCBuffer _cRenderStateBuffer, _cBlurPassBuffer, _cMRTBuffer;
 	ViewProjBuffer _cVPBuffer;
 	ParticleBuffer _cParticleBuffer;
-	ID3D11RenderTargetView* nullRTVs[6] = { nullptr,nullptr,nullptr,nullptr, nullptr, nullptr};
-	ID3D11ShaderResourceView* nullSRVs[6] = { nullptr, nullptr, nullptr, nullptr, nullptr, nullptr };
+	XMFLOAT4X4 _viewProj;
+	std::vector<DrawMatrices> _drawMatrices;
+	DrawMatrices _unsortedDrawMatrices;
+	Frustum _frustum;
+	BoundingSpheres _bounds;
+	std::vector<uint32_t> _visible;
+	size_t _visibleCount = 0;
+	//Where each bounds entry lives, so a sorted list can be walked in any order
+	std::vector<std::pair<const Archetype*, size_t>> _drawRefs;
+	//Terrain chunk a bounds entry covers, nullptr for everything else
+	std::vector<const TerrainChunk*> _drawChunks;
+	std::vector<DrawItem> _drawItems, _shadowItems[2], _drawScratch;
+	std::vector<DrawBatch> _batches, _shadowBatches[2];
+	//Every pass's instance ranges for the frame, uploaded once
+	std::vector<InstanceTransform> _instanceData;
+	StructuredBuffer<InstanceTransform> _instances;
+	SortIdTable _sortIds;
+	std::unordered_map<const GeometryComponent*, std::pair<size_t, XMFLOAT4>> _meshBounds;
+	std::vector<uint32_t> _casters[2];
+	size_t _casterCounts[2] = { 0, 0 };
+	float _shadowDistance = 60.0f;
+	//Must match the ShadowMap depth target, used to snap the light frusta to whole texels
+	float _shadowResolution = 2048.0f;
+	ShadowCache _shadowCache[2];
+	size_t _staticSignature = 0;
+	float _shadowCacheThreshold = 1e-4f;
+	size_t _shadowCacheRebuilds = 0;
+	size_t _shadowCacheFrames = 0;
+	size_t _shadowCacheHits = 0;
+	float _shadowFitSlack = 0.25f;
 public:
 	DirectX11Renderer();
-	~DirectX11Renderer() = default;
+	~DirectX11Renderer();
 	DirectX11Renderer(const DirectX11Renderer&);
 	DirectX11Renderer& operator=(const DirectX11Renderer&);
 
 	void setDirectXModules(const std::weak_ptr<DirectX11Manager>);
-	void onInit(const std::vector<std::shared_ptr<Entity>>&) override;
+	//Swaps the backend frames are submitted through, e.g. a RecordingGraphicsContext wrapping the D3D11 one.
+	//Redundant binds are filtered out in front of it.
+	void setGraphicsContext(const std::shared_ptr<GraphicsContext> gfx);
+	const inline std::shared_ptr<GraphicsContext>& getGraphicsContext() const { return _gfx; }
+	//Where the renderer's own buffers and render graph targets are made, call before onInit.
+	void setGraphicsDevice(const std::shared_ptr<GraphicsDevice> device) { _graphicsDevice = device; }
+	//Binds issued vs dropped as already bound, over the last full frame.
+	const BindStats getBindStats() const { return _stateFilter ? _stateFilter->lastFrame() : BindStats(); }
+	void onInit(const std::vector<EntityHandle>&) override;
 	void onAction() override;
+	void onEntityAdded(const EntityHandle) override;
+	void onEntityRemoved(const EntityHandle) override;
+	void onComponentsChanged(const EntityHandle, const uint16_t added, const uint16_t removed) override;
+	const inline size_t getVisibleCount() const { return _visibleCount; }
+	const inline size_t getCulledCount() const { return _bounds.size() - _visibleCount; }
+	const inline size_t getShadowCasterCount(const int light) const { return _casterCounts[light]; }
+	//How far from the camera shadows reach
+	void setShadowDistance(const float distance) { _shadowDistance = distance; }
+	void setShadowResolution(const float resolution) { _shadowResolution = resolution; }
+	//Largest per-element change in a light's view-projection the cached static layer tolerates.
+	void setShadowCacheThreshold(const float threshold) { _shadowCacheThreshold = threshold; }
+	//How much bigger than the camera slice the shadow maps are, as a fraction of its radius. The camera can move
+	//that far before a map is refitted and its static layer redrawn, at the cost of shadow texel density.
+	void setShadowFitSlack(const float slack) { _shadowFitSlack = slack; }
+	const inline size_t getShadowCacheRebuilds() const { return _shadowCacheRebuilds; }
+	//Shadow passes that had a cache, and those that restored it instead of redrawing
+	const inline size_t getShadowCacheFrames() const { return _shadowCacheFrames; }
+	const inline size_t getShadowCacheHits() const { return _shadowCacheHits; }
+	const inline RenderGraph& getRenderGraph() const { return _graph; }
+	//Levels in the bloom chain, each half the size of the last. Fewer is cheaper but the glow spreads less far.
+	void setBloomLevels(const UINT levels);
+	const inline UINT getBloomLevels() const { return _bloomLevels; }
+	//Formats of the G-buffer targets, the geometry and light shaders have to agree with them. GBufferLayout::packed() opts into the compact one.
+	void setGBufferLayout(const GBufferLayout& layout);
+	const inline GBufferLayout& getGBufferLayout() const { return _gbufferLayout; }
+	const inline bool usesConstantRing() const { return _constantRing.isAvailable(); }
+	const inline size_t getConstantRingWaits() const { return _constantRing.getWaitCount(); }
+	//Geometry and shadow draws are recorded in slices on deferred contexts across the ThreadPool when there are enough of them.
+	void setParallelSubmission(const bool enabled) { _parallelSubmission = enabled; }
+	//Runs of Render_InstancedIndexed draws sharing a mesh become one instanced draw. Off by default, their
+	//shaders have to read InstanceTransform from VS t1 at misc.w + SV_InstanceID in place of m/mvp.
+	//Shadow casters are never merged, the shadow map's depth shaders don't read it.
+	void setInstancing(const bool enabled) { _instancing = enabled; }
+	const inline bool usesInstancing() const { return _instancing; }
+	const inline size_t getDeferredContextCount() const { return _recorder.size(); }
+	const inline size_t getCommandListCount() const { return _recorder.getCommandListCount(); }
 	void changeRenderMode();
 	void changeMRTMode();
 
 private:
 	void createConstantBuffers();
 	void createRasterStates(); 
+	void createDeferredContexts();
+	void bindFrameConstants(GraphicsContext&);
+	void bindGBufferTargets(GraphicsContext&);
+	void buildRenderGraph(const UINT width, const UINT height);
+	const inline EntityHandle getScreenPass(const ScreenPass pass) const { return _passes[static_cast<size_t>(pass)]; }
 	void doGeometryPass();
 	void doLightPass();
-	void doHorizontalBlurPass();
-	void doVerticalBlurPass();
+	void doBlurPass(const float directionX, const float directionY, const UINT sourceWidth, const UINT sourceHeight);
+	void doBloomUpsamplePass(const UINT sourceWidth, const UINT sourceHeight);
 	void doBrightPass();
 	void doFinalPass();
 	void doAnyParticleSystems();
-	void drawPassQuad(const std::shared_ptr<Entity>);
+	void drawPassQuad(const EntityHandle);
+	void computeFrameMatrices();
+	const DrawMatrices& getDrawMatrices(const TransformComponent&, DrawMatrices& scratch) const;
+	void cullGeometry();
+	void updateLightMatrices();
+	void doShadowPass(ShadowMap&, const int light);
+	void drawShadowCasters(ShadowMap&, const int light, const bool staticCasters);
+	void createShadowCache(ShadowMap&, ShadowCache&);
+	void drawGeometry(GraphicsContext&, const Archetype&, const size_t, const UINT instances = 1, const TerrainChunk* chunk = nullptr);
+	//Runs record over batches [first, last), split across deferred contexts when there are enough
+	//draws. setup binds the pass state a deferred context doesn't start with.
+	void recordBatches(const size_t first, const size_t last, FunctionRef<void(GraphicsContext&)> setup,
+		FunctionRef<void(GraphicsContext&, ConstantRing&, DrawState&, const size_t, const size_t)> record);
+	void sortVisible();
+	void sortCasters(const int light);
+	bool isInstanceable(const uint32_t) const;
+	bool isSameBatch(const uint32_t, const uint32_t) const;
+	void batchDraws(const std::vector<DrawItem>&, const bool instanced, std::vector<DrawBatch>&);
+	void batchFrame();
+	uint32_t getSortId(const void*);
+	//Per-draw constants go to a slice of the ring when there is one, otherwise into the tracked buffer.
+	template <class T>
+	static void bindDrawConstants(GraphicsContext& gfx, ConstantRing& ring, const T& data, TrackedCBuffer<T>& fallback, const UINT slot, const bool pixelStage) {
+		if (ring.isAvailable()) {
+			const auto slice = ring.allocate(&data, sizeof(T), gfx);
+			gfx.setVSConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.numConstants);
+			if (pixelStage) gfx.setPSConstantBuffers1(slot, 1, &slice.buffer, &slice.firstConstant, &slice.numConstants);
+			return;
+		}
+		fallback.update(data, gfx);
+		gfx.setVSConstantBuffers(slot, 1, fallback.getAddress());
+		if (pixelStage) gfx.setPSConstantBuffers(slot, 1, fallback.getAddress());
+	}
+	template <class T>
+	void bindDrawConstants(const T& data, TrackedCBuffer<T>& fallback, const UINT slot, const bool pixelStage) {
+		bindDrawConstants(*_gfx, _constantRing, data, fallback, slot, pixelStage);
+	}
+	const XMFLOAT4& getMeshBounds(GeometryComponent&);
 
 };
\ No newline at end of file
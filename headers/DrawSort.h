@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Sort key layout, most significant first: pass | shader | texture set | geometry | depth.
+//Sorting by it groups draws so consecutive ones share as much bound state as possible,
+//and front-to-back within a group.
+constexpr uint32_t SORT_PASS_BITS = 4;
+constexpr uint32_t SORT_SHADER_BITS = 12;
+constexpr uint32_t SORT_TEXTURE_BITS = 12;
+constexpr uint32_t SORT_GEOMETRY_BITS = 12;
+constexpr uint32_t SORT_DEPTH_BITS = 24;
+
+inline uint64_t makeDrawKey(const uint32_t pass, const uint32_t shader, const uint32_t texture, const uint32_t geometry, const uint32_t depth) {
+	uint64_t key = pass & ((1u << SORT_PASS_BITS) - 1);
+	key = (key << SORT_SHADER_BITS) | (shader & ((1u << SORT_SHADER_BITS) - 1));
+	key = (key << SORT_TEXTURE_BITS) | (texture & ((1u << SORT_TEXTURE_BITS) - 1));
+	key = (key << SORT_GEOMETRY_BITS) | (geometry & ((1u << SORT_GEOMETRY_BITS) - 1));
+	key = (key << SORT_DEPTH_BITS) | (depth & ((1u << SORT_DEPTH_BITS) - 1));
+	return key;
+}
+
+//Depth in [0, 1] quantised to the key's depth field.
+inline uint32_t quantiseDepth(const float depth) {
+	const float clamped = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+	return static_cast<uint32_t>(clamped * static_cast<float>((1u << SORT_DEPTH_BITS) - 1));
+}
+
+struct DrawItem {
+	uint64_t key;
+	uint32_t index;
+};
+
+//Maps state objects (shaders, texture sets, meshes) to the small ids packed into draw keys.
+//Open addressing over a table sized once up front, so lookups never allocate. Entries are
+//stamped with the frame that assigned them, older ones count as empty, so starting a frame
+//forgets every id without touching the table.
+class SortIdTable {
+private:
+	static constexpr uint32_t MAX_IDS = (1u << SORT_SHADER_BITS) - 1;
+	//Twice the id count keeps probe runs short when the table is full
+	static constexpr size_t CAPACITY = size_t(1) << (SORT_SHADER_BITS + 1);
+	struct Entry {
+		const void* object;
+		uint32_t id;
+		uint32_t frame;
+	};
+	std::vector<Entry> _entries;
+	uint32_t _count;
+	uint32_t _frame;
+public:
+	SortIdTable() : _entries(CAPACITY, Entry{ nullptr, 0, 0 }), _count(0), _frame(1) {}
+	//Id of object, 0 for nullptr. Assigned in first-seen order starting at 1, objects past
+	//MAX_IDS in a frame all share MAX_IDS, so keys only sort them less finely.
+	uint32_t get(const void* object);
+	//Call before the frame's first get(), ids from earlier frames are dropped.
+	void beginFrame();
+	const inline uint32_t size() const { return _count; }
+};
+
+//Stable LSD radix sort on the key, a byte per pass. Bytes every key shares are skipped,
+//so a frame with few distinct shaders/textures only pays for the fields that vary.
+void radixSortDraws(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch);
@@ -1,38 +1,58 @@
 #pragma once
+#include <array>
 #include <string>
 #include <unordered_map>
 #include <d3d11.h>
 #include <atlbase.h>
 #include "Components/AComponent.h"
 #include "Components/NoneComponent.h"
+#include "Components/ComponentTraits.h"
+#include "EntityHandle.h"
 
+class Archetype;
 class Entity
 {
+	friend Archetype;
+	friend class ArchetypeStore;
 	std::string _name;
 	uint16_t _mask;
-	uint8_t _id;
+	EntityHandle _id;
 	std::unordered_map<ComponentType, std::shared_ptr<AComponent>> _components;
+	std::array<AComponent*, COMPONENT_TYPE_COUNT> _slots;
+	Archetype* _archetype;
+	size_t _row;
 public:
-	Entity(const char* name, const uint8_t id);
-	~Entity() = default;
-	Entity(const Entity&);
-	Entity operator=(const Entity&);
-	Entity(Entity&&);
-	Entity operator=(Entity&&);
+	Entity(const char* name, const EntityHandle id);
+	~Entity();
+	//Archetype columns and the registry hold raw pointers to entities, so they never move.
+	Entity(const Entity&) = delete;
+	Entity& operator=(const Entity&) = delete;
+	Entity(Entity&&) = delete;
+	Entity& operator=(Entity&&) = delete;
 
 	void addComponent(const std::shared_ptr<AComponent> component);
 	void removeComponent(ComponentType type);
+	//Removes then adds in one step so the entity only changes archetype once. Added components
+	//are awoken before systems hear about the new mask.
+	void changeComponents(const uint16_t removeMask, const std::vector<std::shared_ptr<AComponent>>& adds, const CComPtr<ID3D11Device>& device);
 	void awake(const CComPtr<ID3D11Device>&);
 	const std::string& getName() const { return _name; }
 	const uint16_t getMask() const { return _mask; }
-	const uint8_t getId()  const { return _id; }
+	const EntityHandle getId()  const { return _id; }
 
 	template <class T>
 	const std::weak_ptr<T> getComponent(ComponentType type) {
 		auto valueItr = _components.find(type);
 		if (valueItr == _components.end()) //This is fine I expect "empty" to be returned.
-			return std::dynamic_pointer_cast<T>(std::make_shared<NoneComponent>());
-		return std::dynamic_pointer_cast<T>(_components.at(type));
+			return std::weak_ptr<T>();
+		return std::dynamic_pointer_cast<T>(valueItr->second);
 	}
+
+	//Typed lookup through ComponentTraits, nullptr if the entity lacks T.
+	template <class T>
+	T* get() const { return static_cast<T*>(_slots[ComponentTraits<T>::index]); }
+	inline AComponent* getComponentAt(const size_t index) const { return _slots[index]; }
+	template <class T>
+	const bool has() const { return _slots[ComponentTraits<T>::index] != nullptr; }
 };
 
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+//32-bit generational handle: low bits index the registry's sparse array, high bits
+//hold the generation of that slot so a handle to a destroyed entity is rejected.
+struct EntityHandle {
+	static constexpr uint32_t INDEX_BITS = 20;
+	static constexpr uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+	static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+	static constexpr uint32_t MAX_ENTITIES = INDEX_MASK; //INDEX_MASK itself is reserved for the null handle
+
+	uint32_t value = INDEX_MASK;
+
+	EntityHandle() = default;
+	constexpr EntityHandle(const uint32_t index, const uint32_t generation)
+		: value((index & INDEX_MASK) | ((generation & GENERATION_MASK) << INDEX_BITS)) {}
+
+	const inline uint32_t index() const { return value & INDEX_MASK; }
+	const inline uint32_t generation() const { return value >> INDEX_BITS; }
+	const inline bool isNull() const { return index() == INDEX_MASK; }
+	bool operator==(const EntityHandle& other) const { return value == other.value; }
+	bool operator!=(const EntityHandle& other) const { return value != other.value; }
+};
+
+namespace std {
+	template <>
+	struct hash<EntityHandle> {
+		size_t operator()(const EntityHandle& h) const { return hash<uint32_t>()(h.value); }
+	};
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "EntityHandle.h"
+#include "Archetype.h"
+
+class ASystem;
+
+//Live set of entities whose mask contains every bit of the query mask. Kept up to
+//date by the EntityRegistry as components are added/removed, so owners never re-filter.
+class EntityQuery {
+	friend class EntityRegistry;
+private:
+	static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+	uint16_t _mask;
+	ASystem* _listener;
+	std::vector<EntityHandle> _handles;
+	std::vector<uint32_t> _slots;
+	std::vector<Archetype*> _archetypes;
+
+	void insert(const EntityHandle handle);
+	void erase(const EntityHandle handle);
+	void changed(const EntityHandle handle, const uint16_t oldMask, const uint16_t newMask);
+	void addArchetype(Archetype& archetype);
+public:
+	EntityQuery(const uint16_t mask, ASystem* listener);
+	~EntityQuery() = default;
+	EntityQuery(const EntityQuery&) = delete;
+	EntityQuery& operator=(const EntityQuery&) = delete;
+
+	const inline bool matches(const uint16_t mask) const { return mask != 0 && (mask & _mask) == _mask; }
+	const inline bool contains(const EntityHandle handle) const { return handle.index() < _slots.size() && _slots[handle.index()] != INVALID_SLOT; }
+	const inline uint16_t getMask() const { return _mask; }
+	const inline std::vector<EntityHandle>& getHandles() const { return _handles; }
+	const inline size_t size() const { return _handles.size(); }
+	const inline EntityHandle operator[](const size_t i) const { return _handles[i]; }
+
+	template <class Fn>
+	void forEachArchetype(Fn&& fn) const {
+		for (auto* archetype : _archetypes)
+			if (!archetype->empty()) fn(*archetype);
+	}
+};
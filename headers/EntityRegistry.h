@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EntityHandle.h"
+#include "EntityQuery.h"
+
+class Entity;
+
+//Owns every entity in the scene. Handles resolve through a sparse set: the sparse
+//array maps a handle's index to a slot in the densely packed entity arrays.
+class EntityRegistry final
+{
+private:
+	static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+	EntityRegistry() = default;
+	std::vector<uint32_t> _sparse;
+	std::vector<uint16_t> _generations;
+	std::vector<uint32_t> _freeIndices;
+	std::vector<EntityHandle> _dense;
+	std::vector<Entity*> _entities;
+	std::vector<std::unique_ptr<EntityQuery>> _queries;
+	std::mutex _reserveLock;
+	uint32_t _reservedTail = 0;
+
+	//Callers hold _reserveLock, reserve() reads the sizes it changes
+	void growTo(const uint32_t index);
+public:
+	~EntityRegistry();
+	EntityRegistry(const EntityRegistry&) = delete;
+	EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+	static EntityRegistry& getInstance() {
+		static EntityRegistry instance;
+		return instance;
+	}
+	EntityHandle create(const char* name);
+	void destroy(const EntityHandle handle);
+	//Hands out a handle without creating the entity, safe to call from any thread.
+	//Reserved handles stay dead until create(handle, name) or are given back with release().
+	EntityHandle reserve();
+	void create(const EntityHandle reserved, const char* name);
+	void release(const EntityHandle reserved);
+	void clear();
+
+	//Queries are backfilled with existing entities, the listener only hears about later changes.
+	EntityQuery& registerQuery(const uint16_t mask, ASystem* listener = nullptr);
+	void unregisterQuery(const EntityQuery& query);
+	void onMaskChanged(Entity& e, const uint16_t oldMask);
+	void onArchetypeCreated(Archetype& archetype);
+
+	const inline bool isAlive(const EntityHandle handle) const {
+		const auto index = handle.index();
+		return index < _sparse.size() && _sparse[index] != INVALID_SLOT && _generations[index] == handle.generation();
+	}
+	//Raw pointer is only valid until the entity is destroyed, don't store it.
+	inline Entity* get(const EntityHandle handle) const {
+		return isAlive(handle) ? _entities[_sparse[handle.index()]] : nullptr;
+	}
+	const inline std::vector<EntityHandle>& getHandles() const { return _dense; }
+	const inline size_t size() const { return _dense.size(); }
+};
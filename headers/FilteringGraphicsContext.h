@@ -0,0 +1,149 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cstring>
+#include "GraphicsContext.h"
+
+struct BindStats {
+	size_t issued = 0;
+	size_t elided = 0;
+};
+
+//Sits in front of another context and drops binds that match what's already bound. Plain
+//native() helpers can touch anything, so they forget all the tracked state; nativeBind()
+//helpers are remembered per label.
+class FilteringGraphicsContext : public GraphicsContext {
+private:
+	static constexpr uint32_t SLOTS = 16;
+	//D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT
+	static constexpr uint32_t MAX_TARGETS = 8;
+
+	template <class T>
+	struct Cached {
+		T value{};
+		bool known = false;
+		bool matches(const T& v) const { return known && value == v; }
+		void set(const T& v) { value = v; known = true; }
+	};
+	struct VertexBinding {
+		GraphicsBuffer* buffer;
+		uint32_t stride, offset;
+		bool operator==(const VertexBinding& other) const { return buffer == other.buffer && stride == other.stride && offset == other.offset; }
+	};
+	struct IndexBinding {
+		GraphicsBuffer* buffer;
+		GraphicsFormat format;
+		uint32_t offset;
+		bool operator==(const IndexBinding& other) const { return buffer == other.buffer && format == other.format && offset == other.offset; }
+	};
+	struct BlendBinding {
+		GraphicsBlendState* state;
+		float factor[4];
+		uint32_t mask;
+		bool operator==(const BlendBinding& other) const {
+			return state == other.state && mask == other.mask && factor[0] == other.factor[0] && factor[1] == other.factor[1]
+				&& factor[2] == other.factor[2] && factor[3] == other.factor[3];
+		}
+	};
+	struct DepthBinding {
+		GraphicsDepthState* state;
+		uint32_t stencilRef;
+		bool operator==(const DepthBinding& other) const { return state == other.state && stencilRef == other.stencilRef; }
+	};
+	struct ViewportBinding {
+		GraphicsViewport viewport;
+		bool operator==(const ViewportBinding& other) const { return memcmp(&viewport, &other.viewport, sizeof(viewport)) == 0; }
+	};
+	struct TargetBinding {
+		GraphicsRenderTarget* rtvs[MAX_TARGETS];
+		uint32_t count;
+		GraphicsDepthStencil* dsv;
+		bool operator==(const TargetBinding& other) const {
+			if (count != other.count || dsv != other.dsv) return false;
+			for (uint32_t i = 0; i < count; ++i) if (rtvs[i] != other.rtvs[i]) return false;
+			return true;
+		}
+	};
+
+	std::shared_ptr<GraphicsContext> _inner;
+	Cached<TargetBinding> _targets;
+	Cached<GraphicsBuffer*> _vsCBs[SLOTS], _psCBs[SLOTS];
+	Cached<GraphicsShaderResource*> _vsSRVs[SLOTS], _psSRVs[SLOTS];
+	Cached<VertexBinding> _vertexBuffers[SLOTS];
+	Cached<IndexBinding> _indexBuffer;
+	Cached<GraphicsRasterizerState*> _rasterizer;
+	//Only a single viewport is tracked, binding several forgets it
+	Cached<ViewportBinding> _viewport;
+	Cached<BlendBinding> _blend;
+	Cached<DepthBinding> _depth;
+	std::vector<std::pair<const char*, const void*>> _nativeBinds;
+	BindStats _frame, _lastFrame;
+
+	void forgetShaderResources();
+	//Narrows [slot, slot + count) to the slots that actually change, false if none do.
+	template <class T, class V>
+	bool narrow(Cached<T>* cache, const uint32_t slot, const uint32_t count, const V& valueAt, uint32_t& first, uint32_t& last) {
+		first = count, last = 0;
+		for (uint32_t i = 0; i < count; ++i) {
+			if (slot + i < SLOTS && cache[slot + i].matches(valueAt(i))) continue;
+			if (first == count) first = i;
+			last = i + 1;
+		}
+		for (uint32_t i = 0; i < count; ++i)
+			if (slot + i < SLOTS) cache[slot + i].set(valueAt(i));
+		if (first == count) { ++_frame.elided; return false; }
+		++_frame.issued;
+		return true;
+	}
+	template <class T, class V>
+	bool filter(Cached<T>& cache, const V& value) {
+		if (cache.matches(value)) { ++_frame.elided; return false; }
+		cache.set(value);
+		++_frame.issued;
+		return true;
+	}
+public:
+	FilteringGraphicsContext(std::shared_ptr<GraphicsContext> inner) : _inner(inner) {}
+
+	//Forget everything, the next bind of each kind goes through.
+	void invalidate();
+	//Closes the previous frame's counts, call once at the top of the frame.
+	void beginFrame() { _lastFrame = _frame; _frame = BindStats(); }
+	const inline BindStats& lastFrame() const { return _lastFrame; }
+	const inline std::shared_ptr<GraphicsContext>& getInner() const { return _inner; }
+
+	void onNative(const char* label) override;
+	bool onNativeBind(const char* label, const void* object) override;
+	void clearRenderTarget(GraphicsRenderTarget* rtv, const float colour[4]) override { _inner->clearRenderTarget(rtv, colour); }
+	void clearDepthStencil(GraphicsDepthStencil* dsv, const uint32_t flags, const float depth, const uint8_t stencil) override { _inner->clearDepthStencil(dsv, flags, depth, stencil); }
+	void setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv) override;
+	GraphicsDepthStencil* getBoundDepthStencil() override { return _inner->getBoundDepthStencil(); }
+	void setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override;
+	void setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override;
+	void setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override;
+	void setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override;
+	void setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+	void setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset) override;
+	void setRasterizerState(GraphicsRasterizerState* state) override;
+	void setViewports(const uint32_t count, const GraphicsViewport* viewports) override;
+	void setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask) override;
+	void setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef) override;
+	void setPixelShader(GraphicsPixelShader* shader) override;
+	void draw(const uint32_t vertexCount, const uint32_t startVertex) override { _inner->draw(vertexCount, startVertex); }
+	void drawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex) override { _inner->drawIndexed(indexCount, startIndex, baseVertex); }
+	void drawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance) override {
+		_inner->drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	}
+	void copyResource(GraphicsResource* destination, GraphicsResource* source) override { _inner->copyResource(destination, source); }
+	void generateMips(GraphicsShaderResource* srv) override { _inner->generateMips(srv); }
+	void updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size) override { _inner->updateBuffer(buffer, data, size); }
+	void writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard) override { _inner->writeBuffer(buffer, offset, data, size, discard); }
+	void endQuery(GraphicsQuery* query) override { _inner->endQuery(query); }
+	bool isQueryDone(GraphicsQuery* query, const bool flush) override { return _inner->isQueryDone(query, flush); }
+	void finishCommandList(GraphicsCommandList** commands) override;
+	void executeCommandList(GraphicsCommandList* commands) override { _inner->executeCommandList(commands); }
+	bool present(GraphicsSwapChain* swapChain) override;
+	NativeContext* getNative() override { return _inner->getNative(); }
+};
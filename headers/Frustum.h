@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+struct Vertex;
+
+//Six inward-facing planes (left, right, bottom, top, near, far), normalised so a plane's
+//dot product with a point is a signed distance.
+struct Frustum {
+	DirectX::XMFLOAT4 planes[6];
+};
+
+//Bounding spheres in structure-of-arrays form so the culling kernel can test 4/8 at a time.
+struct BoundingSpheres {
+	std::vector<float> x, y, z, radius;
+	void clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+	void push(const DirectX::XMFLOAT4& sphere) { x.push_back(sphere.x); y.push_back(sphere.y); z.push_back(sphere.z); radius.push_back(sphere.w); }
+	const inline size_t size() const { return x.size(); }
+};
+
+//Extracts the planes of a row-vector view * projection matrix (D3D clip space, z in [0, w]).
+Frustum extractFrustum(const DirectX::XMFLOAT4X4& viewProj);
+//Centre of the mesh's AABB in xyz, distance to the furthest vertex in w.
+DirectX::XMFLOAT4 computeBoundingSphere(const std::vector<Vertex>& vertices);
+//Sphere enclosing an axis-aligned box.
+DirectX::XMFLOAT4 boundingSphereFromBox(const DirectX::XMFLOAT3& min, const DirectX::XMFLOAT3& max);
+//Moves a local sphere into world space, the radius grows with the largest axis scale.
+DirectX::XMFLOAT4 transformBoundingSphere(const DirectX::XMFLOAT4& local, DirectX::FXMMATRIX world);
+//Writes the index of every sphere touching the frustum to visible, returns how many were written.
+//visible must have room for spheres.size() entries.
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t* visible);
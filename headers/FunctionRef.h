@@ -0,0 +1,22 @@
+#pragma once
+#include <type_traits>
+#include <utility>
+
+template <class Signature>
+class FunctionRef;
+
+//Non-owning reference to a callable, for parameters that are only called during the call
+//they are passed to. Unlike std::function it never copies the callable to the heap.
+template <class R, class... Args>
+class FunctionRef<R(Args...)> {
+private:
+	const void* _object;
+	R(*_call)(const void*, Args...);
+public:
+	template <class Fn, class = std::enable_if_t<!std::is_same<std::decay_t<Fn>, FunctionRef>::value>>
+	FunctionRef(const Fn& fn) : _object(&fn), _call([](const void* object, Args... args) -> R {
+		return (*static_cast<const Fn*>(object))(std::forward<Args>(args)...);
+	}) {}
+
+	R operator()(Args... args) const { return _call(_object, std::forward<Args>(args)...); }
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include "GraphicsTypes.h"
+
+//The part of ID3D11DeviceContext the renderer drives itself, so a frame can run against a
+//backend other than the GPU. Needs no Windows headers, resources are opaque handles. Helpers
+//that still need the real context (shaders, shadow maps, the G-buffer) are reached through
+//native(), which a backend without one only records.
+class GraphicsContext {
+public:
+	virtual ~GraphicsContext() = default;
+
+	//Called before a native() helper runs, it may have changed any bound state.
+	virtual void onNative(const char* label) {}
+	//Called before a nativeBind() helper, returning false skips it.
+	virtual bool onNativeBind(const char* label, const void* object) { onNative(label); return true; }
+
+	virtual void clearRenderTarget(GraphicsRenderTarget* rtv, const float colour[4]) = 0;
+	virtual void clearDepthStencil(GraphicsDepthStencil* dsv, const uint32_t flags, const float depth, const uint8_t stencil) = 0;
+	virtual void setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv) = 0;
+	//Not add-ref'd, it stays alive while bound.
+	virtual GraphicsDepthStencil* getBoundDepthStencil() = 0;
+	virtual void setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) = 0;
+	virtual void setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) = 0;
+	//D3D11.1 offset binding, first/num are in 16-byte constants (multiples of 16).
+	virtual void setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) = 0;
+	virtual void setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) = 0;
+	virtual void setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) = 0;
+	virtual void setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) = 0;
+	virtual void setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) = 0;
+	virtual void setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset) = 0;
+	virtual void setRasterizerState(GraphicsRasterizerState* state) = 0;
+	virtual void setViewports(const uint32_t count, const GraphicsViewport* viewports) = 0;
+	virtual void setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask) = 0;
+	virtual void setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef) = 0;
+	//Null leaves rasterised pixels unshaded, for depth-only passes.
+	virtual void setPixelShader(GraphicsPixelShader* shader) = 0;
+	virtual void draw(const uint32_t vertexCount, const uint32_t startVertex) = 0;
+	virtual void drawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex) = 0;
+	virtual void drawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance) = 0;
+	virtual void copyResource(GraphicsResource* destination, GraphicsResource* source) = 0;
+	virtual void generateMips(GraphicsShaderResource* srv) = 0;
+	//Map with WRITE_DISCARD, copy, Unmap.
+	virtual void updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size) = 0;
+	//Map with WRITE_NO_OVERWRITE (WRITE_DISCARD when discard) and copy to offset, for sub-allocated buffers.
+	virtual void writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard) = 0;
+	virtual void endQuery(GraphicsQuery* query) = 0;
+	//Whether the GPU has got past the query, flush submits pending work so waiting on it makes progress.
+	virtual bool isQueryDone(GraphicsQuery* query, const bool flush) = 0;
+	//Deferred contexts only, closes what's been recorded into a new reference in *commands and starts
+	//over from default state. *commands must be null.
+	virtual void finishCommandList(GraphicsCommandList** commands) = 0;
+	//Plays a finished command list back, this context's own state is left as it was.
+	virtual void executeCommandList(GraphicsCommandList* commands) = 0;
+	virtual bool present(GraphicsSwapChain* swapChain) = 0;
+	//Null when there's no device behind this context.
+	virtual NativeContext* getNative() = 0;
+
+	template <class Fn>
+	void native(const char* label, Fn&& fn) {
+		onNative(label);
+		if (auto context = getNative()) fn(context);
+	}
+	//A helper that only binds object's own state (e.g. a shader's use()), which a backend
+	//may skip while the same object is still bound under label.
+	template <class Fn>
+	void nativeBind(const char* label, const void* object, Fn&& fn) {
+		if (!onNativeBind(label, object)) return;
+		if (auto context = getNative()) fn(context);
+	}
+};
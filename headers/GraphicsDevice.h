@@ -0,0 +1,21 @@
+#pragma once
+#include "GraphicsTypes.h"
+
+//Creates the resources the renderer manages itself (constant, structured and render graph
+//buffers), so they can be made by a backend other than the GPU. A null ref is a failure.
+class GraphicsDevice {
+public:
+	virtual ~GraphicsDevice() = default;
+
+	//Dynamic, CPU written constant buffer.
+	virtual GraphicsRef<GraphicsBuffer> createConstantBuffer(const size_t size) = 0;
+	//Dynamic structured buffer of count elements, and a view over all of them.
+	virtual bool createStructuredBuffer(const size_t stride, const size_t count, GraphicsRef<GraphicsBuffer>& buffer, GraphicsRef<GraphicsShaderResource>& srv) = 0;
+	//A texture that's both rendered to and sampled, with a full mip chain when mips.
+	virtual bool createRenderTexture(const uint32_t width, const uint32_t height, const GraphicsFormat format, const bool mips,
+		GraphicsRef<GraphicsTexture>& texture, GraphicsRef<GraphicsRenderTarget>& rtv, GraphicsRef<GraphicsShaderResource>& srv) = 0;
+	//For GraphicsContext::endQuery/isQueryDone.
+	virtual GraphicsRef<GraphicsQuery> createEventQuery() = 0;
+	//Constant buffers bound at offsets and mapped NO_OVERWRITE, which ConstantRing needs.
+	virtual bool supportsConstantOffsets() = 0;
+};
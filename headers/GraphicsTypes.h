@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+//Opaque handles to GPU objects. They're the D3D11 interfaces, but only ever forward declared
+//here, so the D3D11 backend passes them straight through and nothing else looks inside.
+struct ID3D11Resource;
+struct ID3D11Buffer;
+struct ID3D11Texture2D;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11ShaderResourceView;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+struct ID3D11PixelShader;
+struct ID3D11Query;
+struct ID3D11CommandList;
+struct ID3D11DeviceContext;
+struct IDXGISwapChain;
+
+using GraphicsResource = ID3D11Resource;
+using GraphicsBuffer = ID3D11Buffer;
+using GraphicsTexture = ID3D11Texture2D;
+using GraphicsRenderTarget = ID3D11RenderTargetView;
+using GraphicsDepthStencil = ID3D11DepthStencilView;
+using GraphicsShaderResource = ID3D11ShaderResourceView;
+using GraphicsRasterizerState = ID3D11RasterizerState;
+using GraphicsBlendState = ID3D11BlendState;
+using GraphicsDepthState = ID3D11DepthStencilState;
+using GraphicsPixelShader = ID3D11PixelShader;
+using GraphicsQuery = ID3D11Query;
+using GraphicsCommandList = ID3D11CommandList;
+using GraphicsSwapChain = IDXGISwapChain;
+//Only ever handed to native() helpers
+using NativeContext = ID3D11DeviceContext;
+
+//Owning reference to a handle, the device that made it supplies the release.
+template <class T>
+using GraphicsRef = std::shared_ptr<T>;
+
+//DXGI_FORMAT values, the D3D11 backend checks the ones named here match.
+using GraphicsFormat = uint32_t;
+constexpr GraphicsFormat GRAPHICS_FORMAT_UNKNOWN = 0;
+constexpr GraphicsFormat GRAPHICS_FORMAT_R32G32B32A32_FLOAT = 2;
+constexpr GraphicsFormat GRAPHICS_FORMAT_R32_UINT = 42;
+
+//Same layout as D3D11_VIEWPORT.
+struct GraphicsViewport {
+	float topLeftX, topLeftY;
+	float width, height;
+	float minDepth, maxDepth;
+};
@@ -0,0 +1,29 @@
+#pragma once
+#include "GraphicsDevice.h"
+
+//Hands out distinct placeholder handles with nothing behind them, pairs with a
+//RecordingGraphicsContext that has no inner context to run frames headless.
+class NullGraphicsDevice : public GraphicsDevice {
+private:
+	bool _constantOffsets;
+	size_t _created = 0;
+
+	template <class T>
+	GraphicsRef<T> placeholder() {
+		//Never dereferenced, a live allocation just keeps each address unique
+		++_created;
+		return GraphicsRef<T>(reinterpret_cast<T*>(new char), [](T* p) { delete reinterpret_cast<char*>(p); });
+	}
+public:
+	//constantOffsets picks whether renderer code takes its ConstantRing path.
+	NullGraphicsDevice(const bool constantOffsets = true) : _constantOffsets(constantOffsets) {}
+
+	GraphicsRef<GraphicsBuffer> createConstantBuffer(const size_t size) override { return placeholder<GraphicsBuffer>(); }
+	bool createStructuredBuffer(const size_t stride, const size_t count, GraphicsRef<GraphicsBuffer>& buffer, GraphicsRef<GraphicsShaderResource>& srv) override;
+	bool createRenderTexture(const uint32_t width, const uint32_t height, const GraphicsFormat format, const bool mips,
+		GraphicsRef<GraphicsTexture>& texture, GraphicsRef<GraphicsRenderTarget>& rtv, GraphicsRef<GraphicsShaderResource>& srv) override;
+	GraphicsRef<GraphicsQuery> createEventQuery() override { return placeholder<GraphicsQuery>(); }
+	bool supportsConstantOffsets() override { return _constantOffsets; }
+	//Handles made so far, including released ones.
+	const inline size_t getCreatedCount() const { return _created; }
+};
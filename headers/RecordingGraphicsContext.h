@@ -0,0 +1,112 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "GraphicsContext.h"
+
+enum class GraphicsCommandType {
+	ClearRenderTarget,
+	ClearDepthStencil,
+	SetRenderTargets,
+	SetVSConstantBuffers,
+	SetPSConstantBuffers,
+	SetVSShaderResources,
+	SetPSShaderResources,
+	SetVertexBuffers,
+	SetIndexBuffer,
+	SetRasterizerState,
+	SetViewports,
+	SetBlendState,
+	SetDepthStencilState,
+	SetPixelShader,
+	Draw,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	CopyResource,
+	GenerateMips,
+	UpdateBuffer,
+	WriteBuffer,
+	EndQuery,
+	FinishCommandList,
+	ExecuteCommandList,
+	Present,
+	Native
+};
+
+//One recorded call. object is the primary resource/state touched, count is the element,
+//index or vertex count, and size the bytes written by an UpdateBuffer.
+struct GraphicsCommand {
+	GraphicsCommandType type;
+	const void* object;
+	const char* label;
+	uint32_t slot;
+	uint32_t count;
+	uint32_t instances;
+	size_t size;
+};
+
+struct GraphicsStats {
+	size_t draws = 0;
+	size_t instances = 0;
+	size_t stateBinds = 0;
+	size_t bufferUpdates = 0;
+	size_t bytesUploaded = 0;
+	size_t renderTargetSwitches = 0;
+	size_t nativeCalls = 0;
+};
+
+//Records the full command stream of a frame. Without an inner context it's a null backend,
+//so the renderer's frame logic runs headless; with one it forwards every call, for capturing
+//real frames.
+class RecordingGraphicsContext : public GraphicsContext {
+private:
+	std::shared_ptr<GraphicsContext> _inner;
+	std::vector<GraphicsCommand> _commands;
+	GraphicsStats _stats;
+	GraphicsDepthStencil* _boundDepthStencil = nullptr;
+
+	void record(const GraphicsCommandType type, const void* object, const uint32_t slot = 0, const uint32_t count = 0, const uint32_t instances = 0, const size_t size = 0, const char* label = nullptr) {
+		_commands.push_back({ type, object, label, slot, count, instances, size });
+	}
+public:
+	RecordingGraphicsContext(std::shared_ptr<GraphicsContext> inner = nullptr) : _inner(inner) {}
+
+	void onNative(const char* label) override;
+	bool onNativeBind(const char* label, const void* object) override;
+
+	void clearRenderTarget(GraphicsRenderTarget* rtv, const float colour[4]) override;
+	void clearDepthStencil(GraphicsDepthStencil* dsv, const uint32_t flags, const float depth, const uint8_t stencil) override;
+	void setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv) override;
+	GraphicsDepthStencil* getBoundDepthStencil() override;
+	void setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override;
+	void setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers) override;
+	void setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants) override;
+	void setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override;
+	void setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs) override;
+	void setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets) override;
+	void setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset) override;
+	void setRasterizerState(GraphicsRasterizerState* state) override;
+	void setViewports(const uint32_t count, const GraphicsViewport* viewports) override;
+	void setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask) override;
+	void setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef) override;
+	void setPixelShader(GraphicsPixelShader* shader) override;
+	void draw(const uint32_t vertexCount, const uint32_t startVertex) override;
+	void drawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex) override;
+	void drawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance) override;
+	void copyResource(GraphicsResource* destination, GraphicsResource* source) override;
+	void generateMips(GraphicsShaderResource* srv) override;
+	void updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size) override;
+	void writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard) override;
+	void endQuery(GraphicsQuery* query) override;
+	//Without an inner context there's no GPU to wait on, every query is done.
+	bool isQueryDone(GraphicsQuery* query, const bool flush) override { return _inner ? _inner->isQueryDone(query, flush) : true; }
+	void finishCommandList(GraphicsCommandList** commands) override;
+	void executeCommandList(GraphicsCommandList* commands) override;
+	bool present(GraphicsSwapChain* swapChain) override;
+	NativeContext* getNative() override { return _inner ? _inner->getNative() : nullptr; }
+
+	const inline std::vector<GraphicsCommand>& getCommands() const { return _commands; }
+	const inline GraphicsStats& getStats() const { return _stats; }
+	//Drops what's been recorded so far, e.g. at the start of each frame.
+	void reset() { _commands.clear(); _stats = GraphicsStats(); }
+};
@@ -30,6 +30,8 @@ public:
 	RenderComponent& operator=(const RenderComponent&);
 
 	const Material& getMaterial() const { return _material; }
+	//Render_InstancedIndexed entities can be batched once DirectX11Renderer::setInstancing is on, their shaders read their transform from the instance buffer.
+	const RenderType getRenderType() const { return _renderType; }
 	const bool isHDR() { return _hdrEnabled; }
 	const bool isAnimated() { return _animationEnabled; }
 	void onAwake(Entity& e, const CComPtr<ID3D11Device>& device);
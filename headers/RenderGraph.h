@@ -0,0 +1,130 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+#include "GraphicsContext.h"
+#include "GraphicsDevice.h"
+
+using RGResource = uint32_t;
+
+//Size and format of a transient target, the graph creates (and shares) the textures.
+struct RGTextureDesc {
+	uint32_t width = 0, height = 0;
+	GraphicsFormat format = GRAPHICS_FORMAT_R32G32B32A32_FLOAT;
+	//Full mip chain, regenerated before any pass samples it after a write.
+	bool mips = false;
+
+	bool operator==(const RGTextureDesc& other) const {
+		return width == other.width && height == other.height && format == other.format && mips == other.mips;
+	}
+};
+
+//Frame passes declare what they read and write, the graph works out the rest: which passes
+//contribute to the output, when each transient target is live, which targets can share a
+//texture, and which render target/shader resource bindings must be cleared between passes.
+//Imported resources (G-buffer, shadow maps) are bound by their passes, the graph only
+//orders and unbinds around them. Passes writing graph textures get a viewport covering them.
+class RenderGraph {
+public:
+	class PassBuilder {
+	private:
+		RenderGraph& _graph;
+		size_t _pass;
+	public:
+		PassBuilder(RenderGraph& graph, const size_t pass) : _graph(graph), _pass(pass) {}
+		//slot < 0 is an ordering dependency only. Transient inputs are bound to slot by the graph,
+		//imported ones by the pass itself, count being how many slots it occupies.
+		PassBuilder& reads(const RGResource resource, const int slot = -1, const uint32_t count = 1);
+		//clear is applied before the first write to the resource each frame.
+		PassBuilder& writes(const RGResource resource, const float* clear = nullptr);
+		//Bound alongside the pass' graph targets, depth isn't a graph resource.
+		PassBuilder& depthStencil(GraphicsDepthStencil* dsv);
+		PassBuilder& execute(std::function<void()> fn);
+	};
+
+private:
+	static constexpr uint32_t NONE = UINT32_MAX;
+	static constexpr uint32_t MAX_SLOTS = 16;
+	static constexpr uint32_t MAX_TARGETS = 8;
+
+	struct Resource {
+		std::string name;
+		RGTextureDesc desc;
+		bool imported;
+		uint32_t target = NONE;
+		bool written = false;
+	};
+	struct Read {
+		RGResource resource;
+		int slot;
+		uint32_t count;
+	};
+	struct Write {
+		RGResource resource;
+		float clear[4];
+		bool hasClear;
+	};
+	struct Pass {
+		std::string name;
+		std::vector<Read> reads;
+		std::vector<Write> writes;
+		std::function<void()> fn;
+		GraphicsDepthStencil* dsv = nullptr;
+		bool live = false;
+	};
+	//A physical target. Imported resources and the back buffer get one each, transients
+	//share pooled ones. Indices stay stable, a pooled target dropped by a compile is just emptied.
+	struct Target {
+		RGTextureDesc desc;
+		GraphicsRef<GraphicsTexture> texture;
+		GraphicsRef<GraphicsRenderTarget> rtv;
+		GraphicsRef<GraphicsShaderResource> srv;
+		bool pooled = false;
+		bool inUse = false;
+		size_t freeAfter = 0;
+		bool mipsDirty = false;
+	};
+
+	std::vector<Resource> _resources;
+	std::vector<Pass> _passes;
+	std::vector<Target> _targets;
+	std::vector<size_t> _order;
+	RGResource _output = NONE;
+	uint32_t _backBuffer = NONE;
+	bool _dirty = true;
+	size_t _transientCount = 0;
+	//What the graph believes is bound, to derive the unbinds
+	uint32_t _boundSRVs[MAX_SLOTS];
+	uint32_t _boundRTs[MAX_TARGETS];
+	uint32_t _boundRTCount = 0;
+
+	void createTarget(GraphicsDevice* device, Target& target);
+	void unbindSlots(GraphicsContext& gfx, const uint32_t target);
+	void bindSlots(GraphicsContext& gfx, const uint32_t slot, const uint32_t count, const uint32_t target, GraphicsShaderResource* srv);
+	void trackRenderTargets(const Pass& pass);
+public:
+	RenderGraph();
+
+	RGResource createTexture(const char* name, const RGTextureDesc& desc);
+	RGResource importResource(const char* name);
+	PassBuilder addPass(const char* name);
+	void setBackBuffer(GraphicsRenderTarget* rtv);
+	//The resource shown on screen, it's rendered straight into the back buffer. Passes that
+	//don't lead to it are culled.
+	void setOutput(const RGResource resource);
+
+	const inline bool isDirty() const { return _dirty; }
+	//Culls, orders and assigns targets, creating any pooled textures that are missing.
+	void compile(GraphicsDevice* device);
+	void execute(GraphicsContext& gfx);
+
+	//View of a compiled graph texture, for passes that have to bind it somewhere the graph doesn't.
+	GraphicsRenderTarget* getRenderTarget(const RGResource resource) const;
+
+	const inline size_t getPassCount() const { return _passes.size(); }
+	const inline size_t getLivePassCount() const { return _order.size(); }
+	const bool isPassLive(const char* name) const;
+	//Transient resources used this compile vs textures backing them.
+	const inline size_t getTransientCount() const { return _transientCount; }
+	const size_t getPooledTargetCount() const;
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Identifies the type a pool serves. One static per type, so its address is unique.
+using PoolTag = const void*;
+template <class T>
+PoolTag poolTag() {
+	static const char tag = 0;
+	return &tag;
+}
+
+//Fixed-size block pool for a single object type. Blocks are bumped out of the pool's own
+//slabs, so objects of one type sit next to each other in memory. Freed blocks go on an
+//intrusive free list and are reused by the next allocation of that type.
+class BlockPool {
+private:
+	struct FreeBlock { FreeBlock* next; };
+	PoolTag _tag;
+	size_t _blockSize;
+	FreeBlock* _free;
+	size_t _live;
+	std::vector<std::unique_ptr<uint8_t[]>> _slabs;
+	uint8_t* _cursor;
+	size_t _remaining;
+
+	void* bump(const size_t slabSize);
+public:
+	BlockPool(const PoolTag tag, const size_t blockSize) : _tag(tag), _blockSize(blockSize), _free(nullptr), _live(0), _cursor(nullptr), _remaining(0) {}
+	const inline size_t getBlockSize() const { return _blockSize; }
+	const inline size_t getLive() const { return _live; }
+	const inline size_t getSlabCount() const { return _slabs.size(); }
+	friend class SceneArena;
+};
+
+//Owns all memory for scene objects: entities and each component type get a pool of their
+//own, which bump-allocates from contiguous slabs. reset() hands every slab back at once.
+class SceneArena final
+{
+public:
+	//max_align_t is only 8 on MSVC, blocks must still hold 16 byte aligned XMVECTOR members
+	static constexpr size_t BLOCK_ALIGN = alignof(std::max_align_t) > 16 ? alignof(std::max_align_t) : 16;
+private:
+	static constexpr size_t SLAB_SIZE = 1 << 16;
+	SceneArena() = default;
+	std::vector<BlockPool> _pools;
+	std::mutex _lock;
+
+	BlockPool& poolFor(const PoolTag tag, const size_t size);
+public:
+	~SceneArena() = default;
+	SceneArena(const SceneArena&) = delete;
+	SceneArena& operator=(const SceneArena&) = delete;
+
+	static SceneArena& getInstance() {
+		static SceneArena instance;
+		return instance;
+	}
+	void* allocate(const PoolTag tag, const size_t size);
+	void deallocate(const PoolTag tag, void* block, const size_t size);
+	//Only valid once every object allocated from the arena has been destroyed, e.g. on scene reload.
+	void reset();
+	const size_t getLiveBlocks();
+	const size_t getChunkCount();
+
+	template <class T, class... Args>
+	T* create(Args&&... args) {
+		static_assert(alignof(T) <= BLOCK_ALIGN, "Type is over-aligned for the scene arena.");
+		return new (allocate(poolTag<T>(), sizeof(T))) T(std::forward<Args>(args)...);
+	}
+	template <class T>
+	void destroy(T* object) { if (!object) return; object->~T(); deallocate(poolTag<T>(), object, sizeof(T)); }
+};
+
+//Standard allocator over the scene arena, used with std::allocate_shared so the
+//control block and component share one pooled block. allocate_shared rebinds it to its
+//control block type, which is distinct per component type and so gets its own pool.
+template <class T>
+struct PoolAllocator {
+	using value_type = T;
+	PoolAllocator() = default;
+	template <class U> PoolAllocator(const PoolAllocator<U>&) {}
+	T* allocate(const size_t n) {
+		static_assert(alignof(T) <= SceneArena::BLOCK_ALIGN, "Type is over-aligned for the scene arena.");
+		return static_cast<T*>(SceneArena::getInstance().allocate(poolTag<T>(), n * sizeof(T)));
+	}
+	void deallocate(T* p, const size_t n) { SceneArena::getInstance().deallocate(poolTag<T>(), p, n * sizeof(T)); }
+	template <class U> bool operator==(const PoolAllocator<U>&) const { return true; }
+	template <class U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+//Preferred way to create components so they land in the scene arena.
+template <class T, class... Args>
+std::shared_ptr<T> makeComponent(Args&&... args) {
+	return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "StateStream.h"
+#include "Systems/ASystem.h"
+
+//Keeps the last few seconds of simulation state in a fixed-size ring so any retained
+//frame can be restored. Every captured frame is XOR'd against the previous capture and
+//zero-run-length encoded; a full keyframe is stored every KEYFRAME_INTERVAL captures
+//so restoring only ever replays a handful of deltas.
+class SimulationRecorder {
+private:
+	static constexpr size_t KEYFRAME_INTERVAL = 16;
+	//Components whose real state lives in a system (bodies, particles). Saving nothing means it wasn't captured.
+	static constexpr uint16_t SIMULATION_OWNED = COMPONENT_COLLIDER | COMPONENT_EMITTER;
+	struct Record {
+		uint64_t frame;
+		size_t offset;
+		size_t encodedSize;
+		size_t rawSize;
+		bool keyframe;
+	};
+	std::vector<uint8_t> _ring;
+	std::vector<Record> _records;
+	size_t _firstRecord, _recordCount;
+	size_t _writeOffset;
+	size_t _capturesSinceKey;
+	uint64_t _frame;
+	uint32_t _captureInterval;
+	std::vector<uint8_t> _current, _previous, _encoded;
+	std::vector<std::shared_ptr<ASystem>> _systems;
+	size_t _unsavedSystems, _unsavedComponents;
+
+	void serialize(std::vector<uint8_t>& out);
+	void deserialize(const std::vector<uint8_t>& in);
+	void encode(const std::vector<uint8_t>& current, const std::vector<uint8_t>& previous);
+	void decode(const Record& record, std::vector<uint8_t>& state) const;
+	void evictOverlapping(const size_t begin, const size_t end);
+	void dropOldest();
+	const Record& record(const size_t i) const { return _records[(_firstRecord + i) % _records.size()]; }
+public:
+	SimulationRecorder(const size_t ringBytes, const size_t maxRecords, const uint32_t captureInterval);
+	~SimulationRecorder() = default;
+	SimulationRecorder(const SimulationRecorder&) = delete;
+	SimulationRecorder& operator=(const SimulationRecorder&) = delete;
+
+	//Systems that carry simulation state of their own (e.g. physics) are snapshotted too.
+	void addSystem(const std::shared_ptr<ASystem> system) { _systems.push_back(system); }
+	//Call once per simulated frame, a snapshot is taken every captureInterval frames.
+	void onFrame();
+	bool restore(const uint64_t frame);
+	//Whether the last capture held all simulation state. Systems whose saveState wrote nothing,
+	//and colliders/emitters that saved nothing, make a restore only partial.
+	const inline bool isComplete() const { return _unsavedSystems == 0 && _unsavedComponents == 0; }
+	const inline size_t getUnsavedSystems() const { return _unsavedSystems; }
+	const inline size_t getUnsavedComponents() const { return _unsavedComponents; }
+	const inline uint64_t getFrame() const { return _frame; }
+	const inline bool empty() const { return _recordCount == 0; }
+	const inline uint64_t getOldestFrame() const { return _recordCount ? record(0).frame : 0; }
+	const inline uint64_t getNewestFrame() const { return _recordCount ? record(_recordCount - 1).frame : 0; }
+};
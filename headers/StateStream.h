@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+//Flat binary writer used for simulation snapshots. The buffer is reused between
+//snapshots so steady-state captures don't allocate.
+class StateWriter {
+private:
+	std::vector<uint8_t>& _buffer;
+public:
+	StateWriter(std::vector<uint8_t>& buffer) : _buffer(buffer) {}
+
+	void writeBytes(const void* data, const size_t size) {
+		const size_t offset = _buffer.size();
+		_buffer.resize(offset + size);
+		std::memcpy(_buffer.data() + offset, data, size);
+	}
+	template <class T>
+	void write(const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "StateWriter only writes trivially copyable types");
+		writeBytes(&value, sizeof(T));
+	}
+	const inline size_t size() const { return _buffer.size(); }
+	//Lets a length prefix be written before the data it describes is known.
+	template <class T>
+	void patch(const size_t offset, const T& value) { std::memcpy(_buffer.data() + offset, &value, sizeof(T)); }
+};
+
+class StateReader {
+private:
+	const uint8_t* _data;
+	size_t _size;
+	size_t _cursor;
+public:
+	StateReader(const uint8_t* data, const size_t size) : _data(data), _size(size), _cursor(0) {}
+
+	bool readBytes(void* out, const size_t size) {
+		if (_cursor + size > _size) return false;
+		std::memcpy(out, _data + _cursor, size);
+		_cursor += size;
+		return true;
+	}
+	template <class T>
+	bool read(T& out) {
+		static_assert(std::is_trivially_copyable<T>::value, "StateReader only reads trivially copyable types");
+		return readBytes(&out, sizeof(T));
+	}
+	void skip(const size_t size) { _cursor = _cursor + size > _size ? _size : _cursor + size; }
+	const inline size_t position() const { return _cursor; }
+	const inline bool atEnd() const { return _cursor >= _size; }
+	//Reader over the next size bytes, advancing past them.
+	StateReader sub(const size_t size) {
+		const size_t available = _cursor + size > _size ? _size - _cursor : size;
+		StateReader reader(_data + _cursor, available);
+		_cursor += available;
+		return reader;
+	}
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include "GraphicsContext.h"
+#include "GraphicsDevice.h"
+
+//A dynamic structured buffer of T that grows to fit, rewritten whole with WRITE_DISCARD.
+template <class T>
+class StructuredBuffer {
+private:
+	GraphicsRef<GraphicsBuffer> _buffer;
+	GraphicsRef<GraphicsShaderResource> _srv;
+	//Kept alongside _srv, *SetShaderResources takes an array
+	GraphicsShaderResource* _srvAddress = nullptr;
+	size_t _capacity = 0;
+public:
+	//Only recreates the buffer when count doesn't fit, capacity doubles so growth is rare.
+	//False if the device couldn't make it.
+	bool reserve(GraphicsDevice& device, const size_t count) {
+		if (count <= _capacity && _buffer) return true;
+		size_t capacity = _capacity ? _capacity : 64;
+		while (capacity < count) capacity *= 2;
+		_srv.reset();
+		_buffer.reset();
+		_srvAddress = nullptr;
+		_capacity = 0;
+		if (!device.createStructuredBuffer(sizeof(T), capacity, _buffer, _srv)) return false;
+		_srvAddress = _srv.get();
+		_capacity = capacity;
+		return true;
+	}
+	void upload(const std::vector<T>& data, GraphicsContext& ctx) {
+		if (data.empty() || data.size() > _capacity) return;
+		ctx.updateBuffer(_buffer.get(), data.data(), data.size() * sizeof(T));
+	}
+	const inline size_t capacity() const { return _capacity; }
+	//For *SetShaderResources
+	inline GraphicsShaderResource* const* getAddress() const { return &_srvAddress; }
+};
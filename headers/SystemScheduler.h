@@ -0,0 +1,31 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "ASystem.h"
+#include "../ThreadPool.h"
+
+//Runs systems as a dependency graph built from their declared component access.
+//A system depends on every earlier-registered system it conflicts with, so the
+//result always matches running them one after another in registration order.
+class SystemScheduler {
+private:
+	struct Node {
+		std::shared_ptr<ASystem> system;
+		std::vector<size_t> dependents;
+		size_t dependencyCount = 0;
+		std::atomic<size_t> remaining{ 0 };
+	};
+	std::vector<std::unique_ptr<Node>> _nodes;
+	bool _dirty;
+
+	void build();
+	void runNode(Node& node, std::atomic<size_t>& pending);
+public:
+	SystemScheduler();
+	~SystemScheduler() = default;
+	SystemScheduler(const SystemScheduler&) = delete;
+	SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+	void add(const std::shared_ptr<ASystem> system);
+	void run();
+};
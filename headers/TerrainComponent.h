@@ -2,9 +2,19 @@
 #include "AComponent.h"
 #include "../BoxCollider.h"
 #include "../Utility.h"
+#include <cfloat>
+
+//A run of voxel planes culled and drawn on its own. Bounds are local space, around its active voxels.
+struct TerrainChunk {
+	XMFLOAT3 min, max;
+	UINT firstInstance;
+	UINT instanceCount;
+};
 
 class TerrainComponent : public AComponent {
 private:
+	//Voxel planes (along i) per chunk
+	static constexpr size_t CHUNK_PLANES = 4;
 	static constexpr UINT _stride = sizeof(uint32_t);
 	static constexpr UINT _offset = 0;
 	std::vector<std::vector<std::vector<uint8_t>>> _activeVoxels;
@@ -14,6 +24,10 @@ private:
 	size_t _instanceCount;
 	CComPtr<ID3D11Buffer> _instanceBuffer, _gcVoxelBuffer;
 	MiscCBuffer _cVoxelBuffer;
+	bool _gridRestored = false;
+	std::vector<TerrainChunk> _chunks;
+	size_t _chunkedInstances = SIZE_MAX;
+	bool _chunksStale = true;
 public:
 	TerrainComponent(const XMFLOAT3 dimensions, const XMFLOAT3 offsets);
 	~TerrainComponent();
@@ -27,6 +41,74 @@ public:
 	void updateGrid(const XMFLOAT3& collisionPosition, const float radius);
 	const size_t getInstanceCount() const { return _instanceCount; }
 	const std::vector<BoxCollider> getColliders() const { return _colliders; }
+	//Local-space box spanned by the voxel grid, voxel (i, j, k) is instanced at offsets + (i, j, k) * dimensions.
+	void getInstanceBounds(XMFLOAT3& min, XMFLOAT3& max) const {
+		const size_t ni = _activeVoxels.size();
+		const size_t nj = ni ? _activeVoxels[0].size() : 0;
+		const size_t nk = nj ? _activeVoxels[0][0].size() : 0;
+		min = _instanceOffsets;
+		max = XMFLOAT3(_instanceOffsets.x + (ni ? ni - 1 : 0) * _instanceDimensions.x,
+			_instanceOffsets.y + (nj ? nj - 1 : 0) * _instanceDimensions.y,
+			_instanceOffsets.z + (nk ? nk - 1 : 0) * _instanceDimensions.z);
+	}
+	//The instance buffer lists active voxels in i, j, k order, so a run of whole i planes is one
+	//contiguous instance range. Rebuilt when the instance count changes or the grid is restored;
+	//if the counts don't add up to the instance buffer's, the whole grid is one chunk.
+	const std::vector<TerrainChunk>& getChunks() {
+		if (!_chunksStale && _chunkedInstances == _instanceCount) return _chunks;
+		_chunks.clear();
+		size_t first = 0;
+		for (size_t i0 = 0; i0 < _activeVoxels.size(); i0 += CHUNK_PLANES) {
+			TerrainChunk chunk = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX), static_cast<UINT>(first), 0 };
+			for (size_t i = i0; i < i0 + CHUNK_PLANES && i < _activeVoxels.size(); ++i)
+				for (size_t j = 0; j < _activeVoxels[i].size(); ++j)
+					for (size_t k = 0; k < _activeVoxels[i][j].size(); ++k) {
+						if (!_activeVoxels[i][j][k]) continue;
+						const XMFLOAT3 p(_instanceOffsets.x + i * _instanceDimensions.x, _instanceOffsets.y + j * _instanceDimensions.y, _instanceOffsets.z + k * _instanceDimensions.z);
+						chunk.min = XMFLOAT3(std::min(chunk.min.x, p.x), std::min(chunk.min.y, p.y), std::min(chunk.min.z, p.z));
+						chunk.max = XMFLOAT3(std::max(chunk.max.x, p.x), std::max(chunk.max.y, p.y), std::max(chunk.max.z, p.z));
+						++chunk.instanceCount;
+					}
+			first += chunk.instanceCount;
+			if (chunk.instanceCount > 0) _chunks.push_back(chunk);
+		}
+		if (first != _instanceCount) {
+			XMFLOAT3 min, max;
+			getInstanceBounds(min, max);
+			_chunks.assign(1, { min, max, 0, static_cast<UINT>(_instanceCount) });
+		}
+		_chunkedInstances = _instanceCount;
+		_chunksStale = false;
+		return _chunks;
+	}
+	//Set when loadState replaces the voxel grid, the instance buffer must then be rebuilt.
+	const bool consumeGridRestored() { const bool restored = _gridRestored; _gridRestored = false; return restored; }
+	void saveState(StateWriter& writer) const override {
+		writer.write(static_cast<uint32_t>(_activeVoxels.size()));
+		for (const auto& plane : _activeVoxels) {
+			writer.write(static_cast<uint32_t>(plane.size()));
+			for (const auto& row : plane) {
+				writer.write(static_cast<uint32_t>(row.size()));
+				writer.writeBytes(row.data(), row.size());
+			}
+		}
+	}
+	void loadState(StateReader& reader) override {
+		uint32_t planes = 0, rows = 0, cells = 0;
+		reader.read(planes);
+		_activeVoxels.resize(planes);
+		for (auto& plane : _activeVoxels) {
+			reader.read(rows);
+			plane.resize(rows);
+			for (auto& row : plane) {
+				reader.read(cells);
+				row.resize(cells);
+				reader.readBytes(row.data(), cells);
+			}
+		}
+		_gridRestored = true;
+		_chunksStale = true;
+	}
 protected:
 	void onPropertyChanged(const AComponent& component) override;
 private:
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "FunctionRef.h"
+
+//Work-stealing pool. Every worker owns a deque, pops its own work LIFO and steals
+//FIFO from the others when empty. Threads that wait on work help run tasks meanwhile.
+class ThreadPool final
+{
+public:
+	//void() callable stored inline, so queueing work never touches the heap.
+	//Captures must fit in CAPACITY bytes, checked at compile time.
+	class Task {
+	public:
+		static constexpr size_t CAPACITY = 48;
+	private:
+		struct Ops {
+			void (*invoke)(void*);
+			void (*move)(void* to, void* from);
+			void (*destroy)(void*);
+		};
+		template <class Fn>
+		static const Ops* opsFor() {
+			static const Ops ops = {
+				[](void* fn) { (*static_cast<Fn*>(fn))(); },
+				[](void* to, void* from) { new (to) Fn(std::move(*static_cast<Fn*>(from))); static_cast<Fn*>(from)->~Fn(); },
+				[](void* fn) { static_cast<Fn*>(fn)->~Fn(); }
+			};
+			return &ops;
+		}
+		alignas(std::max_align_t) unsigned char _storage[CAPACITY];
+		const Ops* _ops = nullptr;
+
+		void reset() { if (_ops) _ops->destroy(_storage); _ops = nullptr; }
+		void take(Task& other) { if (!other._ops) return; other._ops->move(_storage, other._storage); _ops = other._ops; other._ops = nullptr; }
+	public:
+		Task() = default;
+		template <class Fn, class = std::enable_if_t<!std::is_same<std::decay_t<Fn>, Task>::value>>
+		Task(Fn&& fn) {
+			using Stored = std::decay_t<Fn>;
+			static_assert(sizeof(Stored) <= CAPACITY, "Task captures too large, capture by reference instead.");
+			static_assert(alignof(Stored) <= alignof(std::max_align_t), "Task captures over-aligned.");
+			new (_storage) Stored(std::forward<Fn>(fn));
+			_ops = opsFor<Stored>();
+		}
+		~Task() { reset(); }
+		Task(Task&& other) noexcept { take(other); }
+		Task& operator=(Task&& other) noexcept { if (this != &other) { reset(); take(other); } return *this; }
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		void operator()() { _ops->invoke(_storage); }
+		explicit operator bool() const { return _ops != nullptr; }
+	};
+private:
+	//Ring buffer of tasks, the back is the owner's end and the front the thieves'.
+	//Storage is kept between frames and only doubles when a burst outgrows it.
+	struct WorkQueue {
+		static constexpr size_t INITIAL_CAPACITY = 256;
+		std::mutex lock;
+		std::vector<Task> tasks;
+		size_t head = 0;
+		size_t count = 0;
+
+		WorkQueue() : tasks(INITIAL_CAPACITY) {}
+		void pushBack(Task&& task);
+		bool popBack(Task& out);
+		bool popFront(Task& out);
+	};
+	ThreadPool(const size_t workerCount);
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+	std::vector<std::thread> _workers;
+	std::mutex _sleepLock;
+	std::condition_variable _wake;
+	std::atomic<size_t> _queued;
+	std::atomic<size_t> _nextQueue;
+	std::atomic<bool> _running;
+	static thread_local int _workerIndex;
+
+	void workerLoop(const int index);
+	bool pop(const size_t queue, Task& out);
+	bool steal(const size_t thief, Task& out);
+public:
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	static ThreadPool& getInstance() {
+		static ThreadPool instance(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+		return instance;
+	}
+	void submit(Task task);
+	//Runs one queued task on the calling thread, returns false if there was nothing to run.
+	bool runPending();
+	//Blocks until counter reaches zero, running queued tasks in the meantime.
+	void wait(const std::atomic<size_t>& counter);
+	//Splits [0, count) into chunks of at most grain and runs fn(begin, end) across the pool.
+	void parallelFor(const size_t count, const size_t grain, FunctionRef<void(size_t, size_t)> fn);
+	const inline size_t workerCount() const { return _workers.size(); }
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstring>
+#include "GraphicsContext.h"
+#include "GraphicsDevice.h"
+
+struct CBufferStats {
+	size_t uploads = 0;
+	size_t skipped = 0;
+};
+
+//Counts constant buffer uploads per frame, both the ones done and the ones skipped as unchanged.
+class CBufferCounter final
+{
+private:
+	static std::atomic<size_t> _uploads, _skipped;
+	static CBufferStats _lastFrame;
+	static CBufferStats _frameStart;
+public:
+	CBufferCounter() = delete;
+
+	static void onUpload() { ++_uploads; }
+	static void onSkip() { ++_skipped; }
+	//Closes the previous frame's window, call once at the top of the frame loop.
+	static void beginFrame();
+	static const CBufferStats& lastFrame() { return _lastFrame; }
+};
+
+//A dynamic constant buffer that remembers what it last uploaded, so writing identical
+//contents again skips Map/Unmap entirely.
+template <class T>
+class TrackedCBuffer {
+private:
+	GraphicsRef<GraphicsBuffer> _buffer;
+	//Kept alongside _buffer, *SetConstantBuffers takes an array
+	GraphicsBuffer* _address = nullptr;
+	T _lastUpload;
+	bool _uploaded = false;
+public:
+	//False if the device couldn't make the buffer.
+	bool create(GraphicsDevice& device) {
+		_buffer = device.createConstantBuffer(sizeof(T));
+		_address = _buffer.get();
+		_uploaded = false;
+		return _buffer != nullptr;
+	}
+	//Returns whether the GPU copy was written.
+	bool update(const T& data, GraphicsContext& ctx) {
+		if (_uploaded && memcmp(&_lastUpload, &data, sizeof(T)) == 0) {
+			CBufferCounter::onSkip();
+			return false;
+		}
+		ctx.updateBuffer(_address, &data, sizeof(T));
+		_lastUpload = data;
+		_uploaded = true;
+		CBufferCounter::onUpload();
+		return true;
+	}
+	//Forces the next update through, e.g. after something else wrote the buffer.
+	void invalidate() { _uploaded = false; }
+	inline GraphicsBuffer* get() const { return _address; }
+	//For *SetConstantBuffers
+	inline GraphicsBuffer* const* getAddress() const { return &_address; }
+};
@@ -1,42 +1,63 @@
 #pragma once
 #include "AComponent.h"
 #include <DirectXMath.h>
+#include "../TransformHierarchy.h"
 
 using namespace DirectX;
 class TransformComponent : public AComponent {
+	friend TransformHierarchy;
 private:
 	XMFLOAT3 _position, _oPosition; 
-	XMFLOAT3 _orientation, _oOrientation;
+	XMFLOAT4 _orientation, _oOrientation; //Quaternions
 	XMFLOAT3 _scale, _oScale;
 	XMFLOAT3X3 _transform;
 	std::shared_ptr<TransformComponent> _parent;
+	int32_t _hierarchyIndex = -1;
+	//Bumped on every change, the local matrix is only rebuilt when it no longer matches.
+	uint32_t _version = 0;
+	mutable uint32_t _cachedVersion = UINT32_MAX;
+	mutable XMFLOAT4X4 _localCache;
 public:
 	TransformComponent();
 	TransformComponent(XMFLOAT3, XMFLOAT3, XMFLOAT3, std::shared_ptr<TransformComponent>);
-	~TransformComponent() = default;
+	~TransformComponent();
 	TransformComponent(const TransformComponent&);
 	TransformComponent& operator=(const TransformComponent&);
 	TransformComponent(TransformComponent&&) noexcept;
 	TransformComponent& operator=(TransformComponent&&) noexcept;
 
-	const inline XMFLOAT3 getPosition() const { auto p = _parent; return p ? XMFLOAT3(p->_position.x + _position.x, p->_position.y + _position.y, p->_position.z + _position.z) : _position; }
+	//Children report the world position cached by the last TransformHierarchy update.
+	const XMFLOAT3 getPosition() const;
 	const inline XMFLOAT3& getLocalPosition() const { return _position; }
-	const inline XMFLOAT3 getOrientation() const { auto p = _parent; return p ? XMFLOAT3(p->_orientation.x + _orientation.x, p->_orientation.y + _orientation.y, p->_orientation.z + _orientation.z) : _orientation; }
-	const inline XMFLOAT3 getScale() const { auto p = _parent; return p ? XMFLOAT3(p->_scale.x + _scale.x, p->_scale.y + _scale.y, p->_scale.z + _scale.z) : _scale; }
+	//World orientation quaternion, local then each parent's in turn.
+	const XMFLOAT4 getOrientation() const;
+	const inline XMFLOAT4& getLocalOrientation() const { return _orientation; }
+	//World scale, read back from the cached world matrix for children.
+	const XMFLOAT3 getScale() const;
+	const inline XMFLOAT3& getLocalScale() const { return _scale; }
 	const XMFLOAT3X3& getTransform();
+	//Cached world matrix, local * parent world all the way up the hierarchy.
 	const XMMATRIX getTransformAligned() const;
+	const XMMATRIX getLocalAligned() const;
 	const inline std::shared_ptr<TransformComponent> getParent() const { return _parent; }
+	const inline int32_t getHierarchyIndex() const { return _hierarchyIndex; }
+	const inline uint32_t getVersion() const { return _version; }
 
 	void resetTransform();
 	void rotatePosition(const XMFLOAT3& axis, const float angle);
 	void rotate(const XMFLOAT3& axis, const float angle);
+	//Turns the transform about axis in place. The position is left alone whatever point is given.
 	void rotate(const XMFLOAT3& axis, const float angle, const XMFLOAT3 point);
 	void move(const XMFLOAT3& desiredMovement);
 
 	void onAwake(Entity& e, const CComPtr<ID3D11Device>& device);
+	void saveState(StateWriter& writer) const override;
+	void loadState(StateReader& reader) override;
 protected:
 	void onPropertyChanged(const AComponent& component);
 private:
+	void markDirty() { ++_version; if (_hierarchyIndex >= 0) TransformHierarchy::getInstance().markDirty(_hierarchyIndex); }
+	static XMFLOAT4 eulerToQuaternion(const XMFLOAT3& euler);
 	void deepCopy(const TransformComponent&);
 	void moveCopy(TransformComponent&&) noexcept;
 };
\ No newline at end of file
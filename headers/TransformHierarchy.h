@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+class TransformComponent;
+
+//Flat, parent-sorted storage for every awake transform. Parents always sit before their
+//children so world matrices are rebuilt in one forward pass, and only for transforms that
+//changed (or whose ancestors changed) since the last update. Hierarchies can be any depth.
+class TransformHierarchy final
+{
+private:
+	TransformHierarchy() = default;
+	std::vector<TransformComponent*> _transforms;
+	std::vector<int32_t> _parents;
+	std::vector<DirectX::XMFLOAT4X4> _local, _world;
+	std::vector<uint8_t> _dirty, _moved;
+	bool _sorted = true;
+
+	void sort();
+public:
+	~TransformHierarchy() = default;
+	TransformHierarchy(const TransformHierarchy&) = delete;
+	TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+	static TransformHierarchy& getInstance() {
+		static TransformHierarchy instance;
+		return instance;
+	}
+	void add(TransformComponent* transform);
+	void remove(TransformComponent* transform);
+	//Safe to call from update systems running in parallel, each transform owns its own flag.
+	void markDirty(const int32_t index) { _dirty[index] = 1; }
+	//Called once per frame at the sync point, after command buffers have been played back.
+	void update();
+	const inline DirectX::XMFLOAT4X4& getWorld(const int32_t index) const { return _world[index]; }
+	const inline DirectX::XMFLOAT4X4& getLocal(const int32_t index) const { return _local[index]; }
+	//Contiguous world matrices, indexed by TransformComponent::getHierarchyIndex().
+	const inline DirectX::XMFLOAT4X4* getWorldData() const { return _world.data(); }
+	const inline size_t size() const { return _transforms.size(); }
+};
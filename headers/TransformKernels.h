@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <DirectXMath.h>
+
+enum class SimdLevel {
+	Scalar,
+	SSE4,
+	AVX2
+};
+
+//Per-draw matrices laid out the way the shaders read them (already transposed).
+struct DrawMatrices {
+	DirectX::XMFLOAT4X4 m;
+	DirectX::XMFLOAT4X4 mvp;
+};
+
+//Best instruction set this CPU supports, detected once.
+SimdLevel detectSimdLevel();
+
+//Batch kernel over a contiguous array of world matrices (e.g. TransformHierarchy's).
+//Writes transpose(world) and transpose(world * viewProj) for each entry. If lightViewProjs is
+//given, lightOut[i * lightCount + l] receives transpose(world * lightViewProjs[l]).
+void computeDrawMatrices(const DirectX::XMFLOAT4X4* world, const size_t count, const DirectX::XMFLOAT4X4& viewProj, DrawMatrices* out,
+	const DirectX::XMFLOAT4X4* lightViewProjs = nullptr, const size_t lightCount = 0, DirectX::XMFLOAT4X4* lightOut = nullptr);
+//Same as above with a fixed path, so the scalar/SSE4/AVX2 paths can be compared against each other.
+void computeDrawMatrices(const SimdLevel level, const DirectX::XMFLOAT4X4* world, const size_t count, const DirectX::XMFLOAT4X4& viewProj, DrawMatrices* out,
+	const DirectX::XMFLOAT4X4* lightViewProjs = nullptr, const size_t lightCount = 0, DirectX::XMFLOAT4X4* lightOut = nullptr);
@@ -76,7 +76,15 @@ struct LightCBuffer {
 struct DrawFrameBuffer {
     DirectX::XMFLOAT4X4 m;
     DirectX::XMFLOAT4X4 mvp;
-    //X = Exposure Y = HDR? Z = Animation? W = ??
+    //X = Exposure Y = HDR? Z = Animation? W = First instance of a batched draw
+    DirectX::XMFLOAT4 misc;
+};
+
+//Per-instance data of a batched draw, read from a structured buffer at [misc.w + SV_InstanceID].
+struct InstanceTransform {
+    DirectX::XMFLOAT4X4 m;
+    DirectX::XMFLOAT4X4 mvp;
+    //Y = HDR? Z = Animation?
     DirectX::XMFLOAT4 misc;
 };
 
@@ -99,6 +107,31 @@ struct ViewProjBuffer {
     DirectX::XMFLOAT4X4 p;
     DirectX::XMFLOAT4X4 invV;
     DirectX::XMFLOAT4X4 invP;
+    //Inverse of v * p, the light pass unprojects (ndc xy, depth) from the depth buffer to world space with it
+    DirectX::XMFLOAT4X4 invVP;
+    //X = Normals octahedral encoded? (GBufferLayout::octahedralNormals)
+    DirectX::XMFLOAT4 gbuffer;
+};
+
+//Formats of the G-buffer targets. There's no position target, the light pass rebuilds it from
+//depth with invV/invP. The defaults are the full float targets the shaders were written for.
+struct GBufferLayout {
+    DXGI_FORMAT albedo = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    DXGI_FORMAT normal = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    DXGI_FORMAT hdr = DXGI_FORMAT_R32G32B32A32_FLOAT;
+    //Normal target holds two channels, see encodeOctahedral. Passed to the shaders in ViewProjBuffer::gbuffer.x
+    bool octahedralNormals = false;
+
+    //A quarter of the bandwidth, for shaders that write the normal octahedral encoded into two
+    //channels and the light pass decodes it. HDR loses its alpha.
+    static GBufferLayout packed() {
+        GBufferLayout layout;
+        layout.albedo = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        layout.normal = DXGI_FORMAT_R16G16_SNORM;
+        layout.hdr = DXGI_FORMAT_R11G11B10_FLOAT;
+        layout.octahedralNormals = true;
+        return layout;
+    }
 };
 
 //------------------------------------
@@ -226,5 +259,10 @@ HRESULT compileShaderFromFile(LPCWSTR szFileName, LPCSTR szEntryPoint, LPCSTR sz
 
 void createGBuffer(const CComPtr<ID3D11Device>&, const int, const int, RenderTarget&);
 
+//Unit normal to [-1, 1]^2 by projecting onto an octahedron and folding the lower half over,
+//the same as the geometry shaders write and the light shader reads with GBufferLayout::packed.
+DirectX::XMFLOAT2 encodeOctahedral(const DirectX::XMFLOAT3& normal);
+DirectX::XMFLOAT3 decodeOctahedral(const DirectX::XMFLOAT2& encoded);
+
 constexpr float FLEQ_EPSILON = 0.001f;
 inline bool fleq(const float f1, const float f2) { return std::fabs(f1 - f2) < FLEQ_EPSILON; }
\ No newline at end of file
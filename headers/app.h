@@ -2,9 +2,11 @@
 #include <memory>
 #include "Managers/DirectX11Manager.h"
 #include "Systems/ASystem.h"
+#include "Systems/SystemScheduler.h"
 #include "Systems/DirectX11Renderer.h"
 #include "Systems/DirectX11Physics.h"
 #include "Systems/DirectX11Collision.h"
+#include "SimulationRecorder.h"
 
 class App {
 private:
@@ -12,8 +14,11 @@ private:
 	std::shared_ptr<DirectX11Manager> _d3dManager;
 	std::vector<std::shared_ptr<ASystem>> _updateSystems;
 	std::vector<std::shared_ptr<ASystem>> _renderSystems;
+	SystemScheduler _updateScheduler;
+	std::vector<CommandBuffer*> _commandBuffers;
 	std::shared_ptr<DirectX11Physics> _physicsSystem;
 	std::shared_ptr<DirectX11Collision> _collisionSystem;
+	SimulationRecorder _recorder;
 public:
 	App(HWND& hwnd);
 	~App()						= default;
@@ -30,4 +35,7 @@ public:
 	void onCamRotate(const int key);
 	void run();
 	void fireRocket();
+	//Refuses, returning false, while the recorder can't capture every system's state unless
+	//allowPartial; a partial rewind restores components only, physics/particles carry on as they were.
+	bool rewind(const int frames, const bool allowPartial = false);
 };
\ No newline at end of file
@@ -1,21 +1,48 @@
 #include "AComponent.h"
+#include <algorithm>
+#include "../ChangeQueue.h"
 
-AComponent::AComponent(ComponentType type) : _type(type)
+AComponent::AComponent(ComponentType type) : _type(type), _changed(false), _changeStamp(0), _deliveryStamp(0)
 {
 }
 
+AComponent::~AComponent()
+{
+	if (_changed) ChangeQueue::getInstance().remove(this);
+}
+
 void AComponent::addObserver(const std::weak_ptr<AComponent> observer) {
 	_observers.push_back(observer);
 }
 
 void AComponent::removeObserver(const std::weak_ptr<AComponent> observer) {
-	auto locked = observer.lock();
-	for (int i = 0; i < _observers.size(); ++i)
-		if (_observers[i].lock().get() == locked.get())
-			_observers.erase(_observers.begin() + i);
+	//Compare control blocks so expired observers can still be matched
+	_observers.erase(std::remove_if(_observers.begin(), _observers.end(), [&](const std::weak_ptr<AComponent>& o) {
+		return !o.owner_before(observer) && !observer.owner_before(o);
+	}), _observers.end());
 }
 
 void AComponent::notify() {
-	for (auto o : _observers)
-		o.lock()->onPropertyChanged(*this);
-}
\ No newline at end of file
+	_changeStamp = ChangeQueue::getInstance().nextStamp();
+	if (!_changed.exchange(true))
+		ChangeQueue::getInstance().push(this);
+}
+
+void AComponent::deliverChanges(const uint64_t stamp) {
+	_changed = false;
+	bool anyExpired = false;
+	for (const auto& o : _observers) {
+		auto observer = o.lock();
+		if (!observer) {
+			anyExpired = true;
+			continue;
+		}
+		//Observers read the current state of what they watch, one that ran after this last changed has seen it
+		if (observer->_deliveryStamp > _changeStamp) continue;
+		observer->_deliveryStamp = stamp;
+		observer->onPropertyChanged(*this);
+	}
+	if (anyExpired)
+		_observers.erase(std::remove_if(_observers.begin(), _observers.end(),
+			[](const std::weak_ptr<AComponent>& o) { return o.expired(); }), _observers.end());
+}
@@ -1,6 +1,13 @@
 #include "ASystem.h"
 
-ASystem::ASystem(ComponentType mask) : _mask(mask)
+ASystem::ASystem(ComponentType mask) : _mask(mask),
+	_query(EntityRegistry::getInstance().registerQuery(mask, this)), _entities(_query.getHandles()),
+	_reads(UINT16_MAX), _writes(UINT16_MAX), _splitGrain(0)
 {
 
 }
+
+ASystem::~ASystem()
+{
+	EntityRegistry::getInstance().unregisterQuery(_query);
+}
@@ -0,0 +1,162 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+std::atomic<size_t> AllocationCounter::_heapAllocations = 0;
+std::atomic<size_t> AllocationCounter::_heapBytes = 0;
+std::atomic<size_t> AllocationCounter::_poolAllocations = 0;
+std::atomic<size_t> AllocationCounter::_poolReuses = 0;
+AllocationStats AllocationCounter::_lastFrame;
+AllocationStats AllocationCounter::_frameStart;
+
+AllocationStats AllocationCounter::snapshot()
+{
+	AllocationStats stats;
+	stats.heapAllocations = _heapAllocations;
+	stats.heapBytes = _heapBytes;
+	stats.poolAllocations = _poolAllocations;
+	stats.poolReuses = _poolReuses;
+	return stats;
+}
+
+void AllocationCounter::beginFrame()
+{
+	const auto now = snapshot();
+	_lastFrame.heapAllocations = now.heapAllocations - _frameStart.heapAllocations;
+	_lastFrame.heapBytes = now.heapBytes - _frameStart.heapBytes;
+	_lastFrame.poolAllocations = now.poolAllocations - _frameStart.poolAllocations;
+	_lastFrame.poolReuses = now.poolReuses - _frameStart.poolReuses;
+	_frameStart = now;
+}
+
+#ifdef TRACK_ALLOCATIONS
+void* operator new(size_t size)
+{
+	AllocationCounter::onHeapAllocation(size);
+	if (void* p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete[](void* p) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	std::free(p);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationCounter::onHeapAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	std::free(p);
+}
+
+//Over-aligned types (alignas > 16) come through these, they need the matching aligned free
+namespace {
+	void* alignedAllocate(const size_t size, const std::align_val_t alignment)
+	{
+		AllocationCounter::onHeapAllocation(size);
+#ifdef _MSC_VER
+		return _aligned_malloc(size ? size : 1, static_cast<size_t>(alignment));
+#else
+		const size_t align = static_cast<size_t>(alignment);
+		return std::aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+#endif
+	}
+
+	void alignedFree(void* p)
+	{
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	if (void* p = alignedAllocate(size, alignment)) return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return alignedAllocate(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return alignedAllocate(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+	alignedFree(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+	alignedFree(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+	alignedFree(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept
+{
+	alignedFree(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	alignedFree(p);
+}
+#endif
@@ -0,0 +1,43 @@
+#include "Archetype.h"
+#include "Entity.h"
+
+Archetype::Archetype(const uint16_t mask) : _mask(mask)
+{
+	_columnIndex.fill(-1);
+	for (size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i) {
+		if ((mask & (1 << i)) == 0) continue;
+		_columnIndex[i] = static_cast<int8_t>(_columns.size());
+		_columns.emplace_back();
+	}
+}
+
+size_t Archetype::push(Entity& e)
+{
+	for (size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i) {
+		if (_columnIndex[i] < 0) continue;
+		_columns[_columnIndex[i]].push_back(e._slots[i]);
+	}
+	_entities.push_back(&e);
+	return _entities.size() - 1;
+}
+
+//Removes a row by moving the last row into it. Returns the entity now occupying
+//the row so its caller can fix up the cached row index, or nullptr if it was the last.
+Entity* Archetype::swapRemove(const size_t row)
+{
+	const size_t last = _entities.size() - 1;
+	for (auto& column : _columns) {
+		column[row] = column[last];
+		column.pop_back();
+	}
+	_entities[row] = _entities[last];
+	_entities.pop_back();
+	return row == last ? nullptr : _entities[row];
+}
+
+void Archetype::reserve(const size_t extra)
+{
+	for (auto& column : _columns)
+		column.reserve(column.size() + extra);
+	_entities.reserve(_entities.size() + extra);
+}
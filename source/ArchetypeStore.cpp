@@ -0,0 +1,33 @@
+#include "ArchetypeStore.h"
+#include "Entity.h"
+#include "EntityRegistry.h"
+
+Archetype& ArchetypeStore::findOrCreate(const uint16_t mask)
+{
+	auto itr = _archetypes.find(mask);
+	if (itr != _archetypes.end())
+		return *itr->second;
+	auto archetype = std::make_unique<Archetype>(mask);
+	auto* raw = archetype.get();
+	_archetypes.emplace(mask, std::move(archetype));
+	_ordered.push_back(raw);
+	EntityRegistry::getInstance().onArchetypeCreated(*raw);
+	return *raw;
+}
+
+void ArchetypeStore::onMaskChanged(Entity& e)
+{
+	remove(e);
+	if (e.getMask() == 0) return;
+	auto& archetype = findOrCreate(e.getMask());
+	e._row = archetype.push(e);
+	e._archetype = &archetype;
+}
+
+void ArchetypeStore::remove(Entity& e)
+{
+	if (!e._archetype) return;
+	if (auto* moved = e._archetype->swapRemove(e._row))
+		moved->_row = e._row;
+	e._archetype = nullptr;
+}
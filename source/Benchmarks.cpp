@@ -0,0 +1,101 @@
+#include "Benchmarks.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include "EntityRegistry.h"
+#include "Entity.h"
+#include "SceneArena.h"
+#include "TransformComponent.h"
+#include "TransformKernels.h"
+
+namespace {
+	//Runs body repeats times and returns the fastest run in nanoseconds per item.
+	double bestOf(const size_t repeats, const size_t items, const std::function<void()>& body)
+	{
+		double best = 0.0;
+		for (size_t r = 0; r < repeats; ++r) {
+			const auto start = std::chrono::steady_clock::now();
+			body();
+			const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+			const double perItem = elapsed.count() / static_cast<double>(items);
+			if (r == 0 || perItem < best) best = perItem;
+		}
+		return best;
+	}
+}
+
+std::vector<BenchmarkResult> Benchmarks::componentLookup(const size_t entityCount, const size_t repeats)
+{
+	auto& registry = EntityRegistry::getInstance();
+	std::vector<EntityHandle> handles;
+	std::vector<Entity*> entities;
+	handles.reserve(entityCount);
+	entities.reserve(entityCount);
+	for (size_t i = 0; i < entityCount; ++i) {
+		const auto handle = registry.create("benchmark");
+		auto* e = registry.get(handle);
+		e->addComponent(makeComponent<TransformComponent>());
+		handles.push_back(handle);
+		entities.push_back(e);
+	}
+
+	//Sink keeps the lookups from being optimised away.
+	volatile uintptr_t sink = 0;
+	std::vector<BenchmarkResult> results;
+	results.push_back({ "getComponent<T>().lock()", entityCount, bestOf(repeats, entityCount, [&] {
+		uintptr_t acc = 0;
+		for (auto* e : entities)
+			acc += reinterpret_cast<uintptr_t>(e->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock().get());
+		sink = sink + acc;
+	}) });
+	results.push_back({ "get<T>()", entityCount, bestOf(repeats, entityCount, [&] {
+		uintptr_t acc = 0;
+		for (auto* e : entities)
+			acc += reinterpret_cast<uintptr_t>(e->get<TransformComponent>());
+		sink = sink + acc;
+	}) });
+
+	for (const auto handle : handles)
+		registry.destroy(handle);
+	return results;
+}
+
+std::vector<BenchmarkResult> Benchmarks::drawMatrices(const size_t count, const size_t repeats)
+{
+	//Arbitrary but non-trivial matrices, the kernels don't branch on values
+	std::vector<XMFLOAT4X4> world(count);
+	for (size_t i = 0; i < count; ++i)
+		for (int k = 0; k < 16; ++k)
+			world[i].m[k / 4][k % 4] = static_cast<float>((i * 16 + k) % 97) * 0.01f + (k % 5 == 0 ? 1.0f : 0.0f);
+	XMFLOAT4X4 viewProj, lightViewProjs[2];
+	for (int k = 0; k < 16; ++k) {
+		viewProj.m[k / 4][k % 4] = static_cast<float>(k % 7) * 0.1f;
+		lightViewProjs[0].m[k / 4][k % 4] = static_cast<float>(k % 3) * 0.2f;
+		lightViewProjs[1].m[k / 4][k % 4] = static_cast<float>(k % 11) * 0.05f;
+	}
+	std::vector<DrawMatrices> out(count);
+	std::vector<XMFLOAT4X4> lightOut(count * 2);
+
+	static const char* names[] = { "computeDrawMatrices scalar", "computeDrawMatrices SSE4", "computeDrawMatrices AVX2" };
+	std::vector<BenchmarkResult> results;
+	const auto best = detectSimdLevel();
+	for (int level = 0; level <= static_cast<int>(best); ++level) {
+		const auto simd = static_cast<SimdLevel>(level);
+		//Same work as a frame with two shadowed lights
+		results.push_back({ names[level], count, bestOf(repeats, count, [&] {
+			computeDrawMatrices(simd, world.data(), count, viewProj, out.data(), lightViewProjs, 2, lightOut.data());
+		}) });
+	}
+	return results;
+}
+
+std::string Benchmarks::format(const std::vector<BenchmarkResult>& results)
+{
+	std::string out;
+	char line[160];
+	for (const auto& result : results) {
+		snprintf(line, sizeof(line), "[B] %-32s n=%-8zu %8.2f ns/item\n", result.name.c_str(), result.count, result.nanosecondsPerItem);
+		out += line;
+	}
+	return out;
+}
@@ -48,30 +48,23 @@ void CameraComponent::updateProjection(UINT width, UINT height) {
 	XMStoreFloat4x4(&_projection, projectionM);
 }
 
-void CameraComponent::onPropertyChanged(const AComponent& component) {
-	if (component.getType() == COMPONENT_TRANSFORM) {
-		if (&component == _parent.get()) {
-			auto parentPos = _parent->getPosition();
-			XMStoreFloat3(&_lookAt,XMLoadFloat3(&parentPos));
-			XMStoreFloat3(&_pos, XMVectorAdd(XMLoadFloat3(&parentPos), XMLoadFloat3(&_offset)));
-			updateView();
-			return;
-		}
-		auto& transform = dynamic_cast<const TransformComponent&>(component);
-		_pos = transform.getPosition();
-		updateView();
-	}
+//Called once for however many of the two transforms changed since it last ran, so both are re-read.
+void CameraComponent::onPropertyChanged(const AComponent&) {
+	if (_parent)
+		_lookAt = _parent->getPosition();
+	if (auto transform = _transform.lock())
+		_pos = transform->getPosition();
+	updateView();
 }
 
 void CameraComponent::onAwake(Entity& e, const CComPtr<ID3D11Device>& device) {
 	auto transform = e.getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock();
+	_transform = transform;
 	_pos = transform->getPosition();
-	_offset = transform->getLocalPosition();
 	_parent = transform->getParent();
 	if (_parent) {
 		_parent->addObserver(weak_from_this());
-		auto parentPos = _parent->getPosition();
-		XMStoreFloat3(&_lookAt, XMLoadFloat3(&parentPos));
+		_lookAt = _parent->getPosition();
 	}
 	updateView();
 	transform->addObserver(weak_from_this());
@@ -92,11 +85,11 @@ void CameraComponent::deepCopy(const CameraComponent& cc)
 	_pos = cc._pos;
 	_lookAt = cc._lookAt;
 	_up = cc._up;
-	_offset = cc._offset;
 	_fov = cc._fov;
 	_near = cc._near;
 	_far = cc._far;
 	_parent = cc._parent;
+	_transform = cc._transform;
 }
 
 void CameraComponent::moveCopy(CameraComponent&& cc) noexcept {
@@ -105,9 +98,9 @@ void CameraComponent::moveCopy(CameraComponent&& cc) noexcept {
 	_pos = cc._pos;
 	_lookAt = cc._lookAt;
 	_up = cc._up;
-	_offset = cc._offset;
 	_fov = cc._fov;
 	_near = cc._near;
 	_far = cc._far;
 	cc._parent.swap(_parent);
+	cc._transform.swap(_transform);
 }
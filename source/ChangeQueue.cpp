@@ -0,0 +1,24 @@
+#include "ChangeQueue.h"
+#include <algorithm>
+#include "Components/AComponent.h"
+
+void ChangeQueue::push(AComponent* component)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	_changed.push_back(component);
+}
+
+void ChangeQueue::remove(AComponent* component)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	std::replace(_changed.begin(), _changed.end(), component, static_cast<AComponent*>(nullptr));
+}
+
+void ChangeQueue::flush()
+{
+	for (size_t i = 0; i < _changed.size(); ++i) {
+		auto* component = _changed[i];
+		if (component) component->deliverChanges(nextStamp());
+	}
+	_changed.clear();
+}
@@ -0,0 +1,117 @@
+#include "CommandBuffer.h"
+#include <algorithm>
+#include <unordered_map>
+#include "Entity.h"
+#include "EntityRegistry.h"
+#include "ArchetypeStore.h"
+
+namespace {
+	struct PendingEntity {
+		EntityHandle handle;
+		const char* name = nullptr;
+		bool destroyed = false;
+		uint16_t removeMask = 0;
+		uint16_t finalMask = 0;
+		std::array<std::shared_ptr<AComponent>, COMPONENT_TYPE_COUNT> adds;
+	};
+}
+
+EntityHandle CommandBuffer::create(const char* name)
+{
+	const auto handle = EntityRegistry::getInstance().reserve();
+	std::lock_guard<std::mutex> guard(_recordLock);
+	_commands.push_back({ CommandType::Create, handle, COMPONENT_NONE, nullptr, name });
+	return handle;
+}
+
+void CommandBuffer::destroy(const EntityHandle e)
+{
+	std::lock_guard<std::mutex> guard(_recordLock);
+	_commands.push_back({ CommandType::Destroy, e, COMPONENT_NONE, nullptr, {} });
+}
+
+void CommandBuffer::addComponent(const EntityHandle e, const std::shared_ptr<AComponent> component)
+{
+	std::lock_guard<std::mutex> guard(_recordLock);
+	_commands.push_back({ CommandType::AddComponent, e, component->getType(), component, {} });
+}
+
+void CommandBuffer::removeComponent(const EntityHandle e, const ComponentType type)
+{
+	std::lock_guard<std::mutex> guard(_recordLock);
+	_commands.push_back({ CommandType::RemoveComponent, e, type, nullptr, {} });
+}
+
+void CommandBuffer::playback(const std::vector<CommandBuffer*>& buffers, const CComPtr<ID3D11Device>& device)
+{
+	if (std::all_of(buffers.begin(), buffers.end(), [](const CommandBuffer* b) { return b->empty(); }))
+		return;
+	auto& registry = EntityRegistry::getInstance();
+	std::vector<PendingEntity> pending;
+	std::unordered_map<EntityHandle, size_t> lookup;
+
+	//Fold every command into one net change per entity
+	for (auto* buffer : buffers) {
+		for (auto& command : buffer->_commands) {
+			auto itr = lookup.find(command.target);
+			if (itr == lookup.end()) {
+				itr = lookup.emplace(command.target, pending.size()).first;
+				pending.emplace_back();
+				pending.back().handle = command.target;
+				if (auto* e = registry.get(command.target)) pending.back().finalMask = e->getMask();
+			}
+			auto& p = pending[itr->second];
+			const auto index = componentIndex(command.componentType);
+			switch (command.type) {
+			case CommandType::Create:
+				p.name = command.name.c_str();
+				break;
+			case CommandType::Destroy:
+				p.destroyed = true;
+				break;
+			case CommandType::AddComponent:
+				if ((p.finalMask & command.componentType) != 0) break;
+				p.adds[index] = command.component;
+				p.finalMask |= command.componentType;
+				break;
+			case CommandType::RemoveComponent:
+				if ((p.finalMask & command.componentType) == 0) break;
+				if (p.adds[index]) p.adds[index].reset();
+				else p.removeMask |= command.componentType;
+				p.finalMask &= ~command.componentType;
+				break;
+			}
+		}
+	}
+
+	//Destroy first so freed slots are back before anything new lands
+	for (auto& p : pending) {
+		if (!p.destroyed) continue;
+		if (p.name && !registry.isAlive(p.handle)) registry.release(p.handle);
+		else registry.destroy(p.handle);
+	}
+
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [](const PendingEntity& p) { return p.destroyed; }), pending.end());
+	std::sort(pending.begin(), pending.end(), [](const PendingEntity& a, const PendingEntity& b) { return a.finalMask < b.finalMask; });
+
+	auto& store = ArchetypeStore::getInstance();
+	for (size_t begin = 0; begin < pending.size();) {
+		size_t end = begin;
+		while (end < pending.size() && pending[end].finalMask == pending[begin].finalMask) ++end;
+		store.reserve(pending[begin].finalMask, end - begin);
+		for (size_t i = begin; i < end; ++i) {
+			auto& p = pending[i];
+			if (p.name) registry.create(p.handle, p.name);
+			auto* e = registry.get(p.handle);
+			if (!e) continue; //Target was destroyed before playback
+			std::vector<std::shared_ptr<AComponent>> adds;
+			for (auto& component : p.adds)
+				if (component) adds.push_back(std::move(component));
+			e->changeComponents(p.removeMask, adds, device);
+		}
+		begin = end;
+	}
+
+	for (auto* buffer : buffers)
+		buffer->_commands.clear();
+}
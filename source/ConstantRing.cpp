@@ -0,0 +1,76 @@
+#include "ConstantRing.h"
+#include <stdexcept>
+
+bool ConstantRing::create(GraphicsDevice* device, const size_t size, const size_t framesInFlight)
+{
+	_buffer.reset();
+	_fences.clear();
+	_inFlight.clear();
+	if (!device || !device->supportsConstantOffsets()) return false;
+
+	_fences.resize(framesInFlight);
+	for (auto& fence : _fences)
+		if (!(fence = device->createEventQuery())) throw std::runtime_error("[E] Creating constant ring fence.");
+
+	//A constant buffer can't go past 64KB per bind, but the buffer itself can
+	_size = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	_buffer = device->createConstantBuffer(_size);
+	if (!_buffer) throw std::runtime_error("[E] Creating constant ring.");
+	_written = _retired = 0;
+	_nextFence = 0;
+	_discardNext = true;
+	return true;
+}
+
+void ConstantRing::retire(GraphicsContext& ctx, const bool wait)
+{
+	while (!_inFlight.empty()) {
+		const auto& frame = _inFlight.front();
+		if (!ctx.isQueryDone(frame.fence, false)) {
+			if (!wait) return;
+			++_waits;
+			while (!ctx.isQueryDone(frame.fence, true)) {}
+		}
+		_retired = frame.end;
+		_inFlight.pop_front();
+		//Only the oldest frame is ever waited for
+		if (wait) return;
+	}
+}
+
+void ConstantRing::beginFrame(GraphicsContext& ctx)
+{
+	if (!isAvailable() || _fences.empty()) return;
+	retire(ctx, false);
+}
+
+void ConstantRing::endFrame(GraphicsContext& ctx)
+{
+	if (!isAvailable() || _fences.empty()) return;
+	//Every fence is still out, so the GPU is a full ring of frames behind
+	if (_inFlight.size() == _fences.size()) retire(ctx, true);
+	auto* fence = _fences[_nextFence].get();
+	_nextFence = (_nextFence + 1) % _fences.size();
+	ctx.endQuery(fence);
+	_inFlight.push_back({ fence, _written });
+}
+
+ConstantSlice ConstantRing::allocate(const void* data, const size_t size, GraphicsContext& ctx)
+{
+	const size_t aligned = (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	//Nothing to wait on without fences, draws already recorded keep the renamed copy
+	if (_fences.empty() && _written + aligned > _size) discard();
+	const size_t position = _written % _size;
+	//Never split an allocation across the end, skip to the start instead
+	const size_t padding = position + aligned > _size ? _size - position : 0;
+	while (_written + padding + aligned - _retired > _size) {
+		if (_inFlight.empty()) throw std::runtime_error("[E] Constant ring is too small for a single frame.");
+		retire(ctx, true);
+	}
+	_written += padding;
+	const size_t offset = _written % _size;
+	ctx.writeBuffer(_buffer.get(), offset, data, size, _discardNext);
+	_discardNext = false;
+	_written += aligned;
+	return { _buffer.get(), static_cast<uint32_t>(offset / 16), static_cast<uint32_t>(aligned / 16) };
+}
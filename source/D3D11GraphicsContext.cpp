@@ -0,0 +1,55 @@
+#include "D3D11GraphicsContext.h"
+
+//GraphicsContext's types stand in for the D3D11 ones without including them
+static_assert(sizeof(GraphicsViewport) == sizeof(D3D11_VIEWPORT), "GraphicsViewport must match D3D11_VIEWPORT");
+static_assert(GRAPHICS_FORMAT_R32G32B32A32_FLOAT == DXGI_FORMAT_R32G32B32A32_FLOAT, "GraphicsFormat must be DXGI_FORMAT");
+static_assert(GRAPHICS_FORMAT_R32_UINT == DXGI_FORMAT_R32_UINT, "GraphicsFormat must be DXGI_FORMAT");
+
+D3D11GraphicsContext::D3D11GraphicsContext(const CComPtr<ID3D11DeviceContext>& context) : _context(context)
+{
+	if (_context) _context->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&_context1.p));
+}
+
+GraphicsDepthStencil* D3D11GraphicsContext::getBoundDepthStencil()
+{
+	//The binding keeps it alive, so the reference the getter adds can go straight away
+	CComPtr<ID3D11DepthStencilView> dsv;
+	_context->OMGetRenderTargets(0, nullptr, &dsv.p);
+	return dsv.p;
+}
+
+void D3D11GraphicsContext::updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+	if (FAILED(_context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource)))
+		throw std::exception("[E] Updating D11 Buffer.");
+	memcpy(mappedResource.pData, data, size);
+	_context->Unmap(buffer, 0);
+}
+
+void D3D11GraphicsContext::writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard)
+{
+	D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+	if (FAILED(_context->Map(buffer, 0, discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedResource)))
+		throw std::exception("[E] Writing D11 Buffer.");
+	memcpy(static_cast<char*>(mappedResource.pData) + offset, data, size);
+	_context->Unmap(buffer, 0);
+}
+
+void D3D11GraphicsContext::finishCommandList(GraphicsCommandList** commands)
+{
+	if (FAILED(_context->FinishCommandList(FALSE, commands)))
+		throw std::exception("[E] Finishing command list.");
+}
+
+void D3D11GraphicsContext::setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	if (_context1) _context1->VSSetConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+	else _context->VSSetConstantBuffers(slot, count, buffers);
+}
+
+void D3D11GraphicsContext::setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	if (_context1) _context1->PSSetConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+	else _context->PSSetConstantBuffers(slot, count, buffers);
+}
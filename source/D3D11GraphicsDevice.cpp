@@ -0,0 +1,96 @@
+#include "D3D11GraphicsDevice.h"
+
+//Takes over the reference a Create* call returned
+template <class T>
+static GraphicsRef<T> adopt(T* object) {
+	if (!object) return nullptr;
+	return GraphicsRef<T>(object, [](T* p) { p->Release(); });
+}
+
+GraphicsRef<GraphicsBuffer> D3D11GraphicsDevice::createConstantBuffer(const size_t size)
+{
+	D3D11_BUFFER_DESC bd = {};
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = static_cast<UINT>(size);
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ID3D11Buffer* buffer = nullptr;
+	if (FAILED(_device->CreateBuffer(&bd, nullptr, &buffer))) return nullptr;
+	return adopt(buffer);
+}
+
+bool D3D11GraphicsDevice::createStructuredBuffer(const size_t stride, const size_t count, GraphicsRef<GraphicsBuffer>& buffer, GraphicsRef<GraphicsShaderResource>& srv)
+{
+	D3D11_BUFFER_DESC bd = {};
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = static_cast<UINT>(count * stride);
+	bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bd.StructureByteStride = static_cast<UINT>(stride);
+	ID3D11Buffer* rawBuffer = nullptr;
+	if (FAILED(_device->CreateBuffer(&bd, nullptr, &rawBuffer))) return false;
+	buffer = adopt(rawBuffer);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvd = {};
+	srvd.Format = DXGI_FORMAT_UNKNOWN;
+	srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvd.Buffer.FirstElement = 0;
+	srvd.Buffer.NumElements = static_cast<UINT>(count);
+	ID3D11ShaderResourceView* rawSRV = nullptr;
+	if (FAILED(_device->CreateShaderResourceView(rawBuffer, &srvd, &rawSRV))) return false;
+	srv = adopt(rawSRV);
+	return true;
+}
+
+bool D3D11GraphicsDevice::createRenderTexture(const uint32_t width, const uint32_t height, const GraphicsFormat format, const bool mips,
+	GraphicsRef<GraphicsTexture>& texture, GraphicsRef<GraphicsRenderTarget>& rtv, GraphicsRef<GraphicsShaderResource>& srv)
+{
+	D3D11_TEXTURE2D_DESC rtd{};
+	rtd.Width = width;
+	rtd.Height = height;
+	rtd.MipLevels = mips ? 0 : 1;
+	rtd.ArraySize = 1;
+	rtd.Format = static_cast<DXGI_FORMAT>(format);
+	rtd.SampleDesc.Count = 1;
+	rtd.Usage = D3D11_USAGE_DEFAULT;
+	rtd.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	rtd.MiscFlags = mips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+	ID3D11Texture2D* rawTexture = nullptr;
+	if (FAILED(_device->CreateTexture2D(&rtd, nullptr, &rawTexture))) return false;
+	texture = adopt(rawTexture);
+
+	D3D11_RENDER_TARGET_VIEW_DESC rtvd{};
+	rtvd.Format = rtd.Format;
+	rtvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+	rtvd.Texture2D.MipSlice = 0;
+	ID3D11RenderTargetView* rawRTV = nullptr;
+	if (FAILED(_device->CreateRenderTargetView(rawTexture, &rtvd, &rawRTV))) return false;
+	rtv = adopt(rawRTV);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvd{};
+	srvd.Format = rtd.Format;
+	srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvd.Texture2D.MostDetailedMip = 0;
+	srvd.Texture2D.MipLevels = -1;
+	ID3D11ShaderResourceView* rawSRV = nullptr;
+	if (FAILED(_device->CreateShaderResourceView(rawTexture, &srvd, &rawSRV))) return false;
+	srv = adopt(rawSRV);
+	return true;
+}
+
+GraphicsRef<GraphicsQuery> D3D11GraphicsDevice::createEventQuery()
+{
+	D3D11_QUERY_DESC qd = {};
+	qd.Query = D3D11_QUERY_EVENT;
+	ID3D11Query* query = nullptr;
+	if (FAILED(_device->CreateQuery(&qd, &query))) return nullptr;
+	return adopt(query);
+}
+
+bool D3D11GraphicsDevice::supportsConstantOffsets()
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(_device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))) return false;
+	return options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+}
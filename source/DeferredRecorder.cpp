@@ -0,0 +1,74 @@
+#include "DeferredRecorder.h"
+#include <algorithm>
+#include "ThreadPool.h"
+#include "D3D11GraphicsContext.h"
+#include "D3D11GraphicsDevice.h"
+
+void DeferredRecorder::create(ID3D11Device* device, const size_t count, const size_t ringSize)
+{
+	_contexts.clear();
+	if (!device) return;
+	D3D11GraphicsDevice graphicsDevice(device);
+	for (size_t i = 0; i < count; ++i) {
+		CComPtr<ID3D11DeviceContext> deferred;
+		//Single threaded devices can't make them, everything then records on the immediate context
+		if (FAILED(device->CreateDeferredContext(0, &deferred.p))) { _contexts.clear(); return; }
+		auto context = std::make_unique<Context>();
+		context->index = i;
+		context->gfx = std::make_shared<FilteringGraphicsContext>(std::make_shared<D3D11GraphicsContext>(deferred));
+		context->ring.create(&graphicsDevice, ringSize, 0);
+		_contexts.push_back(std::move(context));
+	}
+}
+
+void DeferredRecorder::captureState(GraphicsContext& immediate)
+{
+	_viewportCount = 0;
+	auto context = immediate.getNative();
+	if (!context) return;
+	_viewportCount = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+	context->RSGetViewports(&_viewportCount, _viewports);
+	context->IAGetPrimitiveTopology(&_topology);
+	_rasterizer.Release();
+	context->RSGetState(&_rasterizer.p);
+	for (UINT i = 0; i < D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT; ++i) {
+		_vsSamplers[i].Release();
+		_psSamplers[i].Release();
+	}
+	context->VSGetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, &_vsSamplers[0].p);
+	context->PSGetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, &_psSamplers[0].p);
+}
+
+void DeferredRecorder::inheritState(Context& context)
+{
+	context.gfx->native("inheritState", [&](auto& deferred) {
+		deferred->RSSetViewports(_viewportCount, _viewports);
+		deferred->IASetPrimitiveTopology(_topology);
+		deferred->RSSetState(_rasterizer);
+		deferred->VSSetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, &_vsSamplers[0].p);
+		deferred->PSSetSamplers(0, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT, &_psSamplers[0].p);
+	});
+}
+
+void DeferredRecorder::record(GraphicsContext& immediate, const size_t count, const size_t slices, FunctionRef<void(Context&, size_t, size_t)> fn)
+{
+	if (count == 0 || _contexts.empty()) return;
+	captureState(immediate);
+	const size_t sliceCount = std::min(std::max<size_t>(slices, 1), _contexts.size());
+	const size_t grain = (count + sliceCount - 1) / sliceCount;
+	ThreadPool::getInstance().parallelFor(count, grain, [&](const size_t begin, const size_t end) {
+		//Slice n always lands on context n, whichever thread runs it
+		auto& context = *_contexts[begin / grain];
+		context.ring.discard();
+		inheritState(context);
+		fn(context, begin, end);
+		context.gfx->finishCommandList(&context.commands.p);
+	});
+	//Slices are contiguous runs of the sorted draws, playing them back in order keeps the sort
+	for (size_t begin = 0; begin < count; begin += grain) {
+		auto& context = *_contexts[begin / grain];
+		immediate.executeCommandList(context.commands.p);
+		context.commands.Release();
+		++_commandLists;
+	}
+}
@@ -2,44 +2,46 @@
 #include "DirectX11Renderer.h"
 #include "../Components/ComponentDefinitions.h"
 #include "../Managers/CameraManager.h"
+#include "../TransformHierarchy.h"
+#include "../D3D11GraphicsContext.h"
+#include "../D3D11GraphicsDevice.h"
+#include "../ThreadPool.h"
 
 #define DEBUG_PARTICLE_SYSTEM
 
+//MRT views the light shader writes straight to the screen
+static bool isLightPassView(const MRT_MODE mode) {
+	return mode == MRT_MODE::DIFFUSE || mode == MRT_MODE::NORM || mode == MRT_MODE::SUNLIGHT_DEPTH
+		|| mode == MRT_MODE::LIGHT || mode == MRT_MODE::MOONLIGHT_DEPTH;
+}
+
 DirectX11Renderer::DirectX11Renderer() 
 	: ASystem(static_cast<ComponentType>(COMPONENT_GEOMETRY |
 										COMPONENT_RENDER    |
 										COMPONENT_SHADER    |
-										COMPONENT_TRANSFORM)), _renderMode(RENDER_MODE::WIREFRAME), _mrtMode(MRT_MODE::DEFAULT)
+										COMPONENT_TRANSFORM)), 
+	_lights(EntityRegistry::getInstance().registerQuery(COMPONENT_LIGHT)),
+	_passes(EntityRegistry::getInstance().registerQuery(COMPONENT_GEOMETRY | COMPONENT_SHADER)),
+	_particleSystems(EntityRegistry::getInstance().registerQuery(COMPONENT_EMITTER)),
+	_renderMode(RENDER_MODE::WIREFRAME), _mrtMode(MRT_MODE::DEFAULT)
 {}
 
+DirectX11Renderer::~DirectX11Renderer()
+{
+	auto& registry = EntityRegistry::getInstance();
+	registry.unregisterQuery(_lights);
+	registry.unregisterQuery(_passes);
+	registry.unregisterQuery(_particleSystems);
+}
 
-void DirectX11Renderer::onInit(const std::vector<std::shared_ptr<Entity>>& entities) {
-	const auto passMask = COMPONENT_GEOMETRY | COMPONENT_SHADER;
-	for (const auto& entity : entities) {
-		auto mask = getMask();
-		auto entityMask = entity->getMask();
-		if ((entityMask & mask) >= mask)
-			_entities.push_back(entity);
-
-		if ((entityMask & COMPONENT_LIGHT) >= COMPONENT_LIGHT)
-			_lights.push_back(entity);
-
-		if ((entityMask & passMask) == passMask)
-			_passes.push_back(entity);
-
-		if ((entityMask & COMPONENT_EMITTER) >= COMPONENT_EMITTER)
-			_particleSystems.push_back(entity);
-
-		if ((entityMask & (mask | COMPONENT_TERRAIN)) >= (mask | COMPONENT_TERRAIN))
-		{
-			auto& terrain = entity->getComponent<TerrainComponent>(COMPONENT_TERRAIN);
-			terrain.lock()->updateInstanceBuffer(_context);
-		}
-	}
+void DirectX11Renderer::onInit(const std::vector<EntityHandle>& entities) {
+	//Entities are already sorted into our queries, terrain just needs its instances uploading
+	for (const auto handle : _entities)
+		onEntityAdded(handle);
 
 	//Load shadow shaders
-	auto layoutInst = _entities[0].lock()->getComponent<ShaderComponent>(COMPONENT_SHADER).lock()->getVertexLayout();
-	auto layoutNoInst = _entities[1].lock()->getComponent<ShaderComponent>(COMPONENT_SHADER).lock()->getVertexLayout();
+	auto layoutInst = resolve(_entities[0])->get<ShaderComponent>()->getVertexLayout();
+	auto layoutNoInst = resolve(_entities[1])->get<ShaderComponent>()->getVertexLayout();
 
 	_sunlight = std::make_unique<ShadowMap>(_device);
 	_sunlight->addShader(_device, "Shaders\\SunShadowInst.hlsli");
@@ -55,6 +57,7 @@ void DirectX11Renderer::onInit(const std::vector<std::shared_ptr<Entity>>& entit
 
 	createConstantBuffers();
 	createRasterStates();
+	createDeferredContexts();
 	_cRenderStateBuffer.misc = XMFLOAT4(1,0,0,0);
 	_cUpdateBuffer.dt = XMFLOAT2(0, 0);
 	_cUpdateBuffer.t = XMFLOAT2(0, 0);
@@ -64,9 +67,9 @@ void DirectX11Renderer::onInit(const std::vector<std::shared_ptr<Entity>>& entit
 	_cDrawBuffer.misc.x = 1.0f;
 	_cDrawBuffer.misc.w = 0.0f; //This won't be used, but defensive programming
 	for (int i = 0; i < 2; ++i) {
-		auto lightEntity = _lights[i].lock();
-		auto light = lightEntity->getComponent<LightComponent>(COMPONENT_LIGHT).lock();
-		auto transform = lightEntity->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock();
+		auto lightEntity = resolve(_lights[i]);
+		auto light = lightEntity->get<LightComponent>();
+		auto transform = lightEntity->get<TransformComponent>();
 		const auto& lightPos = transform->getPosition();
 		const auto& lightAmb = light->getAmbient();
 		const float intensity = light->getIntensity();
@@ -81,25 +84,19 @@ void DirectX11Renderer::onInit(const std::vector<std::shared_ptr<Entity>>& entit
 	}
 	_cLightBuffer.currentLightCount.x = 1;
 	_cMRTBuffer.misc.x = static_cast<float>(_mrtMode);
-	updateD11Buffer(_gcLightBuffer.p, _cLightBuffer, _context.p);
-	updateD11Buffer(_gcMRTBuffer.p, _cMRTBuffer, _context.p);
+	_gcLightBuffer.update(_cLightBuffer, *_gfx);
+	_gcMRTBuffer.update(_cMRTBuffer, *_gfx);
 }
 
 void DirectX11Renderer::onAction() {
-	if (!_swapChain) { throw std::exception("Swap chain not set in DirectX11Renderer. Try calling 'setSwapChain'"); }
+	if (!_gfx) { throw std::exception("Graphics context not set in DirectX11Renderer. Try calling 'setDirectXModules'"); }
+	_stateFilter->beginFrame();
+	_constantRing.beginFrame(*_gfx);
+	_sortIds.beginFrame();
 	
-	_context->ClearRenderTargetView(_renderTargetView.p, DirectX::Colors::CornflowerBlue);
-	_gbuffer.clear(_context);
-	_context->ClearRenderTargetView(_lightPassOutput.getRTV().p, DirectX::Colors::CornflowerBlue);
-	_context->ClearRenderTargetView(_blurPassOutput.getRTV().p, DirectX::Colors::CornflowerBlue);
-	_context->ClearDepthStencilView(_depthStencilView.p, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-	_sunlight->clearDepthBuffer(_context);
-	_moonlight->clearDepthBuffer(_context);
 	//Update cbuffers
 	{
-		ID3D11Buffer* buffers[6] = { _gcDrawBuffer.p, _gcUpdateBuffer.p, _gcRenderStateCBuffer.p, _gcVPBuffer.p, _gcMRTBuffer.p, _gcLightBuffer.p };
-		_context->VSSetConstantBuffers(0, 6, buffers);
-		_context->PSSetConstantBuffers(2, 1, &_gcRenderStateCBuffer.p);
+		bindFrameConstants(*_gfx);
 		XMMATRIX invV;
 		{ // Update Camera Buffer Data
 			auto& cameraManager = CameraManager::getInstance();
@@ -115,79 +112,67 @@ void DirectX11Renderer::onAction() {
 			XMStoreFloat4x4(&_cVPBuffer.invV, invV);
 			auto invP = XMMatrixInverse(nullptr, projAlignedTransposed);
 			XMStoreFloat4x4(&_cVPBuffer.invP, invP);
+			const auto viewProj = XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj));
+			XMStoreFloat4x4(&_viewProj, viewProj);
+			XMStoreFloat4x4(&_cVPBuffer.invVP, XMMatrixTranspose(XMMatrixInverse(nullptr, viewProj)));
+			_cVPBuffer.gbuffer = XMFLOAT4(_gbufferLayout.octahedralNormals ? 1.0f : 0.0f, 0, 0, 0);
 		}
 		{ // Update Timer Buffer Data
 			_cUpdateBuffer.dt.x = Timer::getInstance().delta();
 			_cUpdateBuffer.t.x = Timer::getInstance().elapsed();
 		}
-		{ // Update Light Buffer Data
-			for (int i = 0; i < 2; ++i) {
-				auto light = _lights[i].lock();
-				auto transform = light->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock();
-				auto& pos = transform->getPosition();
-				XMStoreFloat4(&_cLightBuffer.light[i].position, XMLoadFloat3(&pos));
-				auto lo = transform->getOrientation();
-				auto lightOrientationMat = XMMatrixRotationX(lo.x) * XMMatrixRotationY(lo.y) * XMMatrixRotationZ(lo.z);
-				auto lightView = XMMatrixLookAtLH(XMLoadFloat4(&_cLightBuffer.light[i].position), XMVectorSet(0, 0, 0, 1), 
-					XMVector3Transform(XMVectorSet(0, 1, 0, 1), lightOrientationMat));
-				//auto lightProj = XMMatrixPerspectiveFovLH(1.57f, 1.47f, 0.01f, 30.0f);
-				XMFLOAT3 centerLS;
-				XMStoreFloat3(&centerLS,XMVector3Transform(XMVectorSet(0, 0, 0, 1), lightView));
-				constexpr int r = 35;
-				auto lightProj = XMMatrixOrthographicOffCenterLH(centerLS.x - r, centerLS.x + r, centerLS.y - r, centerLS.y + r, centerLS.z - r, centerLS.z + r);
-				XMStoreFloat4x4(&_cLightBuffer.light[i].viewProj, XMMatrixMultiply(XMMatrixTranspose(lightProj), XMMatrixTranspose(lightView)));
-			}
-		}
-		
-		updateD11Buffer(_gcLightBuffer.p, _cLightBuffer, _context.p);
-		updateD11Buffer(_gcUpdateBuffer.p, _cUpdateBuffer, _context.p);
-		updateD11Buffer(_gcRenderStateCBuffer.p, _cRenderStateBuffer, _context.p);
-		updateD11Buffer(_gcVPBuffer.p, _cVPBuffer, _context.p);
+		_gcUpdateBuffer.update(_cUpdateBuffer, *_gfx);
+		_gcRenderStateCBuffer.update(_cRenderStateBuffer, *_gfx);
+		_gcVPBuffer.update(_cVPBuffer, *_gfx);
 	}
-	//Draw passes
+	computeFrameMatrices();
+	cullGeometry();
+	updateLightMatrices();
+	batchFrame();
+	//Draw passes, the debug views stop at the light pass so the post passes get culled
 	{
-		doGeometryPass();
-		//doAnyParticleSystems();
-		_context->OMSetRenderTargets(6, nullRTVs, nullptr);
-		_context->PSSetShaderResources(0, 6, nullSRVs);
-		_lightPassOutput.bindToRenderTarget(_context);
-		_gbuffer.bindShaderResources(_context); // 0 diffuse 1 normal 2 hdr
-		_sunlight->bindDepthResourceToShader(_context, 3); // 3 sun depth
-		_moonlight->bindDepthResourceToShader(_context, 4); // 4 moon depth
-
-		{
-			if (_mrtMode == MRT_MODE::DIFFUSE || _mrtMode == MRT_MODE::NORM 
-				|| _mrtMode == MRT_MODE::SUNLIGHT_DEPTH || _mrtMode == MRT_MODE::LIGHT || _mrtMode == MRT_MODE::MOONLIGHT_DEPTH) 
-				_context->OMSetRenderTargets(1, &_renderTargetView.p, nullptr);
-			doLightPass();
-			if (_mrtMode == MRT_MODE::DIFFUSE || _mrtMode == MRT_MODE::NORM || _mrtMode == MRT_MODE::SUNLIGHT_DEPTH || _mrtMode == MRT_MODE::LIGHT || _mrtMode == MRT_MODE::MOONLIGHT_DEPTH)
-				goto cleanup;
-		}
-		
-		_brightPassOutput.bindToRenderTarget(_context); 
-		_lightPassOutput.generateMips(_context);
-		_lightPassOutput.bindToPixelShaderResource(0, _context); // Lit Scene Slot 0 
-		doBrightPass();
-
-		_blurPassOutput.bindToRenderTarget(_context);
-		_brightPassOutput.bindToPixelShaderResource(1, _context); // Downsampled Bright Slot 1
-		doHorizontalBlurPass();
-		doVerticalBlurPass();
-
-		_context->OMSetRenderTargets(1, &_renderTargetView.p, nullptr);	
-		_blurPassOutput.bindToPixelShaderResource(1, _context); // Blurred Image Slot 1
-		doFinalPass();
+		_graph.setOutput(isLightPassView(_mrtMode) ? _rgLit : _rgComposite);
+		if (_graph.isDirty()) _graph.compile(_graphicsDevice.get());
+		_graph.execute(*_gfx);
 	}
-	cleanup:
-	//Present & Cleanup
-	{
-		if(FAILED(_swapChain->Present(0, 0))) {
-			//HRESULT hr = _device->GetDeviceRemovedReason();
-			throw std::exception("[E] Presenting scene.");
-		}
-		_context->OMSetRenderTargets(6, nullRTVs, nullptr);
-		_context->PSSetShaderResources(0, 6, nullSRVs);
+	//Present
+	if(!_gfx->present(_swapChain)) {
+		//HRESULT hr = _device->GetDeviceRemovedReason();
+		throw std::exception("[E] Presenting scene.");
 	}
+	_constantRing.endFrame(*_gfx);
+}
+
+void DirectX11Renderer::bindFrameConstants(GraphicsContext& gfx) {
+	ID3D11Buffer* buffers[6] = { _gcDrawBuffer.get(), _gcUpdateBuffer.get(), _gcRenderStateCBuffer.get(), _gcVPBuffer.get(), _gcMRTBuffer.get(), _gcLightBuffer.get() };
+	gfx.setVSConstantBuffers(0, 6, buffers);
+	gfx.setPSConstantBuffers(2, 1, _gcRenderStateCBuffer.getAddress());
+}
+
+void DirectX11Renderer::bindGBufferTargets(GraphicsContext& gfx) {
+	ID3D11RenderTargetView* rtvs[3] = { _graph.getRenderTarget(_rgAlbedo), _graph.getRenderTarget(_rgNormal), _graph.getRenderTarget(_rgHDR) };
+	gfx.setRenderTargets(3, rtvs, _depthStencilView);
+}
+
+void DirectX11Renderer::onEntityAdded(const EntityHandle handle)
+{
+	if (!_gfx) return;
+	if (auto terrain = resolve(handle)->get<TerrainComponent>())
+		_gfx->native("terrain.updateInstanceBuffer", [&](auto& context) { terrain->updateInstanceBuffer(context); });
+}
+
+void DirectX11Renderer::onComponentsChanged(const EntityHandle handle, const uint16_t added, const uint16_t)
+{
+	//Terrain added to an entity that was already drawn still needs its instance buffer
+	if (added & COMPONENT_TERRAIN) onEntityAdded(handle);
+}
+
+void DirectX11Renderer::onEntityRemoved(const EntityHandle handle)
+{
+	const auto entity = resolve(handle);
+	if (!entity) return;
+	if (const auto geometry = entity->get<GeometryComponent>())
+		_meshBounds.erase(geometry);
 }
 
 void DirectX11Renderer::changeRenderMode()
@@ -207,34 +192,30 @@ void DirectX11Renderer::changeRenderMode()
 		_cRenderStateBuffer.misc.y = 1;
 		break;
 	}
-	updateD11Buffer(_gcRenderStateCBuffer.p, _cRenderStateBuffer, _context.p);
+	_gcRenderStateCBuffer.update(_cRenderStateBuffer, *_gfx);
 }
 
 void DirectX11Renderer::changeMRTMode() {
 	_cMRTBuffer.misc.x = static_cast<float>(++_mrtMode);
-	updateD11Buffer(_gcMRTBuffer.p, _cMRTBuffer, _context.p);
+	_gcMRTBuffer.update(_cMRTBuffer, *_gfx);
 }
 
 void DirectX11Renderer::doAnyParticleSystems() {
-	_gbuffer.bindRenderTargets(_context, _depthStencilView);
-	_context->OMSetDepthStencilState(_depthDisabledState.p, 0);
-	for (const auto& e : _particleSystems) {
-		const auto& emitter = e.lock()->getComponent<EmitterComponent>(COMPONENT_EMITTER).lock();
-
-		const auto& shader = e.lock()->getComponent<ShaderComponent>(COMPONENT_SHADER).lock();
-		shader->use(_context);
-
-		auto& cameraManager = CameraManager::getInstance();
-		auto& view = cameraManager.getView();
-		auto& proj = cameraManager.getProjection();
-		auto viewT = XMMatrixTranspose(XMLoadFloat4x4(&view));
-		auto projT = XMMatrixTranspose(XMLoadFloat4x4(&proj));
-		const auto& transform = e.lock()->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock();
-		const auto modelT = XMMatrixTranspose(transform->getTransformAligned());
-		auto mvp = projT * viewT * modelT;
-		XMStoreFloat4x4(&_cDrawBuffer.m, modelT);
-		XMStoreFloat4x4(&_cDrawBuffer.mvp, mvp);
-		updateD11Buffer(_gcDrawBuffer.p, _cDrawBuffer, _context.p);
+	bindGBufferTargets(*_gfx);
+	_gfx->setDepthStencilState(_depthDisabledState.p, 0);
+	for (const auto handle : _particleSystems.getHandles()) {
+		const auto entity = resolve(handle);
+		if (!entity) continue;
+		const auto emitter = entity->get<EmitterComponent>();
+
+		const auto shader = entity->get<ShaderComponent>();
+		_gfx->native("shader.use", [&](auto& context) { shader->use(context); });
+
+		const auto transform = entity->get<TransformComponent>();
+		const auto& matrices = getDrawMatrices(*transform, _unsortedDrawMatrices);
+		_cDrawBuffer.m = matrices.m;
+		_cDrawBuffer.mvp = matrices.mvp;
+		bindDrawConstants(_cDrawBuffer, _gcDrawBuffer, 0, true);
 
 		const auto& emitterStartCol = emitter->getStartColour();
 		_cParticleBuffer.startColour = XMFLOAT4(emitterStartCol.x, emitterStartCol.y, emitterStartCol.z, 1);
@@ -244,208 +225,553 @@ void DirectX11Renderer::doAnyParticleSystems() {
 		_cParticleBuffer.misc.y = emitter->getLifespan();
 		const auto& emitterDirection = emitter->getDirection();
 		_cParticleBuffer.direction = XMFLOAT4(emitterDirection.x, emitterDirection.y, emitterDirection.z, 1);
-		const auto& emitterPosition = e.lock()->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock()->getPosition();
+		const auto& emitterPosition = transform->getPosition();
 		_cParticleBuffer.emitterPosition = XMFLOAT4(emitterPosition.x, emitterPosition.y, emitterPosition.z, 1);
-		updateD11Buffer(_gcParticleBuffer, _cParticleBuffer, _context);
-		_context->VSSetConstantBuffers(7, 1, &_gcParticleBuffer.p);
-		_context->OMSetBlendState(emitter->getBlendState(), nullptr, 0xffffffff);
+		bindDrawConstants(_cParticleBuffer, _gcParticleBuffer, 7, false);
+		_gfx->setBlendState(emitter->getBlendState(), nullptr, 0xffffffff);
 		const UINT stride = sizeof(SimpleVertex);
 		const UINT offset = 0;
-		_context->IASetVertexBuffers(0, 1, &emitter->getVertices().p, &stride, &offset);
+		_gfx->setVertexBuffers(0, 1, &emitter->getVertices().p, &stride, &offset);
 		const auto particleCount = emitter->getParticleCount();
-		_context->Draw(6 * particleCount, 0);
+		_gfx->draw(6 * particleCount, 0);
 	}
-	_context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
-	_context->OMSetDepthStencilState(nullptr, 0);
+	_gfx->setBlendState(nullptr, nullptr, 0xffffffff);
+	_gfx->setDepthStencilState(nullptr, 0);
 }
 
 void DirectX11Renderer::doFinalPass() {
-	auto& entity = _passes[2];
-	_blurPassOutput.bindToPixelShaderResource(1, _context);
-	drawPassQuad(entity);
+	drawPassQuad(getScreenPass(ScreenPass::Final));
 }
 
 void DirectX11Renderer::doGeometryPass() {
-	if (_renderMode != RENDER_MODE::WIREFRAME) { _context->RSSetState(_rasterState); }
-	else { _context->RSSetState(_rasterState_WIRE); }
-	auto& cameraManager = CameraManager::getInstance();
-	auto& view = cameraManager.getView();
-	auto& proj = cameraManager.getProjection();
-	auto viewT = XMMatrixTranspose(XMLoadFloat4x4(&view));
-	auto projT = XMMatrixTranspose(XMLoadFloat4x4(&proj));
-
-	std::shared_ptr<ShaderComponent> _prevShader;
-	for (const auto& e : _entities) {
-		auto entity = e.lock();
-		//Render target is changed for shadows - needs to be reset again before next entity
-		_gbuffer.bindRenderTargets(_context, _depthStencilView);
-		//Read Render and Set buffers accordingly
-		{
- 			const auto render = entity->getComponent<RenderComponent>(COMPONENT_RENDER).lock();
-			_cDrawBuffer.misc.y = render->isHDR() ? 1.0f : 0.0f;
-			_cDrawBuffer.misc.z = render->isAnimated() ? 1.0f : 0.0f;
-		}
-		//Read Transform and Set M/MVP Buffers
-		{
-			const auto transform = entity->getComponent<TransformComponent>(COMPONENT_TRANSFORM).lock();
-			auto modelT = XMMatrixTranspose(transform->getTransformAligned());
-			auto mvp = projT * viewT * modelT;
-			XMStoreFloat4x4(&_cDrawBuffer.m, modelT);
-			XMStoreFloat4x4(&_cDrawBuffer.mvp, mvp);
-			updateD11Buffer(_gcDrawBuffer.p, _cDrawBuffer, _context.p);
-			updateD11Buffer(_gcVPBuffer.p, _cVPBuffer, _context.p);
-		}
-	
-		//Set shaders
-		{
-			const auto shader = entity->getComponent<ShaderComponent>(COMPONENT_SHADER).lock();
-			shader->use(_context);
-		}
+	const auto setup = [&](GraphicsContext& gfx) {
+		if (_renderMode != RENDER_MODE::WIREFRAME) { gfx.setRasterizerState(_rasterState); }
+		else { gfx.setRasterizerState(_rasterState_WIRE); }
+		bindGBufferTargets(gfx);
+	};
+	setup(*_gfx);
+
+	recordBatches(0, _batches.size(), setup, [&](GraphicsContext& gfx, ConstantRing& ring, DrawState& state, const size_t begin, const size_t end) {
+		for (size_t b = begin; b < end; ++b) {
+			const auto& batch = _batches[b];
+			const auto& archetype = *_drawRefs[_drawItems[batch.begin].index].first;
+			const size_t i = _drawRefs[_drawItems[batch.begin].index].second;
+			//Read Render and Set buffers accordingly
+			{
+				const auto render = archetype.get<RenderComponent>(i);
+				state.constants.misc.y = render->isHDR() ? 1.0f : 0.0f;
+				state.constants.misc.z = render->isAnimated() ? 1.0f : 0.0f;
+			}
+			//Read Transform and Set M/MVP Buffers, batches read theirs from the instance buffer
+			{
+				const auto& matrices = getDrawMatrices(*archetype.get<TransformComponent>(i), state.scratch);
+				state.constants.m = matrices.m;
+				state.constants.mvp = matrices.mvp;
+				state.constants.misc.w = batch.count > 1 ? static_cast<float>(batch.instanceBase) : 0.0f;
+				bindDrawConstants(gfx, ring, state.constants, state.buffer, 0, true);
+			}
 
-		//Set PS Resources
-		{
-			const auto texture = entity->getComponent<TextureComponent>(COMPONENT_TEXTURE).lock();
-			ID3D11ShaderResourceView* textures[3] = { texture->getAlbedo().p, texture->getNormal().p, texture->getDisplacement().p };
-			ID3D11ShaderResourceView* vTextures[1] = { texture->getDisplacement().p };
-			_context->PSSetShaderResources(0, 3, textures);
-			_context->VSSetShaderResources(0, 1, vTextures);
+			//Set shaders
+			{
+				const auto shader = archetype.get<ShaderComponent>(i);
+				gfx.nativeBind("shader.use", shader, [&](auto& context) { shader->use(context); });
+			}
+
+			//Set PS Resources
+			if (archetype.has(COMPONENT_TEXTURE)) {
+				const auto texture = archetype.get<TextureComponent>(i);
+				ID3D11ShaderResourceView* textures[3] = { texture->getAlbedo().p, texture->getNormal().p, texture->getDisplacement().p };
+				ID3D11ShaderResourceView* vTextures[1] = { texture->getDisplacement().p };
+				gfx.setPSShaderResources(0, 3, textures);
+				gfx.setVSShaderResources(0, 1, vTextures);
+			}
+
+			drawGeometry(gfx, archetype, i, static_cast<UINT>(batch.count), _drawChunks[_drawItems[batch.begin].index]);
 		}
+	});
+	_gfx->setRasterizerState(_rasterState_QUAD);
+
+}
+
+void DirectX11Renderer::doShadowPass(ShadowMap& shadowMap, const int light) {
+	auto& cache = _shadowCache[light];
+	if (!cache.depth) createShadowCache(shadowMap, cache);
 
-		//Set vertex/index buffers
-		size_t indexCount;
-		{
-			const auto geometry = entity->getComponent<GeometryComponent>(COMPONENT_GEOMETRY).lock();
-			indexCount = geometry->getIndices().size();
-			auto& gVertices = geometry->getGVertices();
-			auto& gIndices = geometry->getGIndices();
-			UINT stride = geometry->getStride();
-			UINT offset = 0;
-			_context->IASetVertexBuffers(0, 1, &gVertices.p, &stride, &offset);
-			_context->IASetIndexBuffer(gIndices.p, DXGI_FORMAT_R32_UINT, 0);
+	//Static casters are only redrawn when the cached layer is stale, otherwise it's copied back in
+	const bool rebuild = !cache.valid || !cache.depth;
+	if (cache.depth) {
+		++_shadowCacheFrames;
+		if (!rebuild) ++_shadowCacheHits;
+	}
+	if (rebuild) _gfx->native("shadowMap.clearDepthBuffer", [&](auto& context) { shadowMap.clearDepthBuffer(context); });
+	else _gfx->copyResource(cache.depth.p, cache.staticLayer.p);
+	_gfx->native("shadowMap.bindDSVSetNullRenderTarget", [&](auto& context) { shadowMap.bindDSVSetNullRenderTarget(context); });
+	if (rebuild) {
+		drawShadowCasters(shadowMap, light, true);
+		if (cache.depth) {
+			//Can't copy out of a bound depth target
+			_gfx->setRenderTargets(0, nullptr, nullptr);
+			_gfx->copyResource(cache.staticLayer.p, cache.depth.p);
+			_gfx->native("shadowMap.bindDSVSetNullRenderTarget", [&](auto& context) { shadowMap.bindDSVSetNullRenderTarget(context); });
+			cache.valid = true;
 		}
+		++_shadowCacheRebuilds;
+	}
+	drawShadowCasters(shadowMap, light, false);
+}
 
-		//If terrain exists, draw instanced - else don't
-		{
-			const auto terrain = entity->getComponent<TerrainComponent>(COMPONENT_TERRAIN).lock();
-			if (terrain)
+void DirectX11Renderer::drawShadowCasters(ShadowMap& shadowMap, const int light, const bool staticCasters) {
+	//Terrain is the static layer, everything else is redrawn on top each frame. Casters sort by
+	//variant first and only terrain uses variant 0, so the static batches come first.
+	const auto& batches = _shadowBatches[light];
+	const auto& items = _shadowItems[light];
+	const auto firstDynamic = std::partition_point(batches.begin(), batches.end(), [&](const DrawBatch& batch) {
+		return _drawRefs[items[batch.begin].index].first->has(COMPONENT_TERRAIN);
+	}) - batches.begin();
+	const size_t first = staticCasters ? 0 : firstDynamic;
+	const size_t last = staticCasters ? firstDynamic : batches.size();
+	const auto setup = [&](GraphicsContext& gfx) {
+		gfx.native("shadowMap.bindDSVSetNullRenderTarget", [&](auto& context) { shadowMap.bindDSVSetNullRenderTarget(context); });
+	};
+	recordBatches(first, last, setup, [&](GraphicsContext& gfx, ConstantRing& ring, DrawState& state, const size_t begin, const size_t end) {
+		int boundVariant = -1;
+		for (size_t b = begin; b < end; ++b) {
+			const auto& batch = batches[b];
+			const auto& archetype = *_drawRefs[items[batch.begin].index].first;
+			const size_t i = _drawRefs[items[batch.begin].index].second;
 			{
-				terrain->setInstanceBuffer(_context, 1, 6);
-				auto instCount = terrain->getInstanceCount();
-				_context->DrawIndexedInstanced(indexCount, instCount, 0, 0, 0);
-				_sunlight->use(0, _context);
-				_sunlight->bindDSVSetNullRenderTarget(_context);
-				_context->DrawIndexedInstanced(indexCount, instCount, 0, 0, 0);
-				_moonlight->use(0, _context);
-				_moonlight->bindDSVSetNullRenderTarget(_context);
-				_context->DrawIndexedInstanced(indexCount, instCount, 0, 0, 0);
+				const auto render = archetype.get<RenderComponent>(i);
+				state.constants.misc.y = render->isHDR() ? 1.0f : 0.0f;
+				state.constants.misc.z = render->isAnimated() ? 1.0f : 0.0f;
+				const auto& matrices = getDrawMatrices(*archetype.get<TransformComponent>(i), state.scratch);
+				state.constants.m = matrices.m;
+				state.constants.mvp = matrices.mvp;
+				state.constants.misc.w = batch.count > 1 ? static_cast<float>(batch.instanceBase) : 0.0f;
+				bindDrawConstants(gfx, ring, state.constants, state.buffer, 0, false);
 			}
-			else {
-				_context->DrawIndexed(indexCount, 0, 0);
-				_sunlight->use(1, _context);
-				_sunlight->bindDSVSetNullRenderTarget(_context);
-				_context->DrawIndexed(indexCount, 0, 0);
-				_moonlight->use(1, _context);
-				_moonlight->bindDSVSetNullRenderTarget(_context);
-				_context->DrawIndexed(indexCount, 0, 0);
+			//Shader 0 reads per-instance data, 1 doesn't
+			const int variant = archetype.has(COMPONENT_TERRAIN) ? 0 : 1;
+			if (variant != boundVariant) {
+				gfx.native("shadowMap.use", [&](auto& context) { shadowMap.use(variant, context); });
+				//Depth only, with no render target bound there's nothing for a pixel shader to write
+				gfx.setPixelShader(nullptr);
+				boundVariant = variant;
 			}
+			drawGeometry(gfx, archetype, i, static_cast<UINT>(batch.count), _drawChunks[items[batch.begin].index]);
 		}
+	});
+}
+
+void DirectX11Renderer::recordBatches(const size_t first, const size_t last, FunctionRef<void(GraphicsContext&)> setup,
+	FunctionRef<void(GraphicsContext&, ConstantRing&, DrawState&, const size_t, const size_t)> record) {
+	const size_t count = last - first;
+	//Deferred contexts record against the device, a context without one gets everything on the immediate path
+	const size_t slices = _parallelSubmission && _gfx->getNative() ? std::min(_recorder.size(), count / MIN_SLICE_DRAWS) : 0;
+	if (slices < 2) {
+		auto& state = _drawStates[0];
+		state.constants = _cDrawBuffer;
+		if (!_instanceData.empty()) _gfx->setVSShaderResources(INSTANCE_SLOT, 1, _instances.getAddress());
+		record(*_gfx, _constantRing, state, first, last);
+		return;
+	}
+	_recorder.record(*_gfx, count, slices, [&](DeferredRecorder::Context& context, const size_t begin, const size_t end) {
+		auto& gfx = *context.gfx;
+		auto& state = _drawStates[context.index + 1];
+		state.constants = _cDrawBuffer;
+		//A command list's first map of a buffer has to discard, so the fallback can't skip it
+		state.buffer.invalidate();
+		bindFrameConstants(gfx);
+		if (!_instanceData.empty()) gfx.setVSShaderResources(INSTANCE_SLOT, 1, _instances.getAddress());
+		setup(gfx);
+		record(gfx, context.ring, state, first + begin, first + end);
+	});
+}
+
+void DirectX11Renderer::createShadowCache(ShadowMap& shadowMap, ShadowCache& cache) {
+	//ShadowMap doesn't hand out its depth texture, so pick it up from the output merger once bound
+	_gfx->native("shadowMap.bindDSVSetNullRenderTarget", [&](auto& context) { shadowMap.bindDSVSetNullRenderTarget(context); });
+	auto dsv = _gfx->getBoundDepthStencil();
+	//No device behind the context (null backend), nothing to cache
+	if (!dsv) return;
+	CComPtr<ID3D11Resource> resource;
+	dsv->GetResource(&resource.p);
+	HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&cache.depth.p));
+	if (FAILED(hr)) throw std::exception("[E] Shadow map depth is not a 2D texture in DirectX11Renderer.");
+	D3D11_TEXTURE2D_DESC desc;
+	cache.depth->GetDesc(&desc);
+	hr = _device->CreateTexture2D(&desc, nullptr, &cache.staticLayer.p);
+	if (FAILED(hr)) throw std::exception("[E] Creating static shadow layer in DirectX11Renderer.");
+	cache.valid = false;
+}
+
+void DirectX11Renderer::drawGeometry(GraphicsContext& gfx, const Archetype& archetype, const size_t i, const UINT instances, const TerrainChunk* chunk) {
+	//Set vertex/index buffers
+	size_t indexCount;
+	{
+		const auto geometry = archetype.get<GeometryComponent>(i);
+		indexCount = geometry->getIndices().size();
+		auto& gVertices = geometry->getGVertices();
+		auto& gIndices = geometry->getGIndices();
+		UINT stride = geometry->getStride();
+		UINT offset = 0;
+		gfx.setVertexBuffers(0, 1, &gVertices.p, &stride, &offset);
+		gfx.setIndexBuffer(gIndices.p, DXGI_FORMAT_R32_UINT, 0);
 	}
-	_context->RSSetState(_rasterState_QUAD);
 
+	//If terrain exists, draw the chunk's instances - else don't instance
+	if (archetype.has(COMPONENT_TERRAIN)) {
+		const auto terrain = archetype.get<TerrainComponent>(i);
+		gfx.native("terrain.setInstanceBuffer", [&](auto& context) { terrain->setInstanceBuffer(context, 1, 6); });
+		if (chunk) gfx.drawIndexedInstanced(indexCount, chunk->instanceCount, 0, 0, chunk->firstInstance);
+		else gfx.drawIndexedInstanced(indexCount, terrain->getInstanceCount(), 0, 0, 0);
+	}
+	else if (instances > 1) {
+		gfx.drawIndexedInstanced(indexCount, instances, 0, 0, 0);
+	}
+	else {
+		gfx.drawIndexed(indexCount, 0, 0);
+	}
 }
 
 void DirectX11Renderer::doLightPass()
 {
-	auto& entity = _passes[0];
-	_context->PSSetConstantBuffers(5, 1, &_gcLightBuffer.p);
-	_context->PSSetConstantBuffers(2, 1, &_gcVPBuffer.p);
-	_context->PSSetConstantBuffers(0, 1, &_gcDrawBuffer.p);
-	drawPassQuad(entity);
+	//0 albedo 1 normal 2 hdr are bound by the graph, position comes from depth unprojected with the VP buffer's invVP
+	_gfx->setPSShaderResources(5, 1, &_depthStencilSRV.p); // 5 scene depth
+	_gfx->native("sunlight.bindDepthResourceToShader", [&](auto& context) { _sunlight->bindDepthResourceToShader(context, 3); }); // 3 sun depth
+	_gfx->native("moonlight.bindDepthResourceToShader", [&](auto& context) { _moonlight->bindDepthResourceToShader(context, 4); }); // 4 moon depth
+	_gfx->setPSConstantBuffers(5, 1, _gcLightBuffer.getAddress());
+	_gfx->setPSConstantBuffers(2, 1, _gcVPBuffer.getAddress());
+	bindDrawConstants(_cDrawBuffer, _gcDrawBuffer, 0, true);
+	drawPassQuad(getScreenPass(ScreenPass::Light));
 }
 
-void DirectX11Renderer::doHorizontalBlurPass()
+void DirectX11Renderer::doBlurPass(const float directionX, const float directionY, const UINT sourceWidth, const UINT sourceHeight)
 {
-	auto& entity = _passes[1];
-	_context->VSSetConstantBuffers(6, 1, &_gcBlurPassBuffer.p);
-	_cBlurPassBuffer.misc.x = 1;
-	_cBlurPassBuffer.misc.y = 0;
-	updateD11Buffer(_gcBlurPassBuffer.p, _cBlurPassBuffer, _context.p);
-	drawPassQuad(entity);
+	//ZW is the texel size of the texture sampled. The blur shader has to step by it (direction * misc.zw) rather
+	//than a full screen texel, or every level below full resolution blurs too narrowly.
+	_cBlurPassBuffer.misc = XMFLOAT4(directionX, directionY, 1.0f / sourceWidth, 1.0f / sourceHeight);
+	bindDrawConstants(_cBlurPassBuffer, _gcBlurPassBuffer, 6, false);
+	drawPassQuad(getScreenPass(ScreenPass::Blur));
 }
 
-void DirectX11Renderer::doBrightPass() {
-	auto& entity = _passes[3];
-	drawPassQuad(entity);
+void DirectX11Renderer::doBloomUpsamplePass(const UINT sourceWidth, const UINT sourceHeight)
+{
+	//No direction samples the smaller level in place, bilinear filtering does the upscale
+	_gfx->setBlendState(_additiveBlendState.p, nullptr, 0xffffffff);
+	doBlurPass(0, 0, sourceWidth, sourceHeight);
+	_gfx->setBlendState(nullptr, nullptr, 0xffffffff);
 }
 
-void DirectX11Renderer::doVerticalBlurPass()
-{
-	auto& entity = _passes[1];
-	_cBlurPassBuffer.misc.x = 0;
-	_cBlurPassBuffer.misc.y = 1;
-	updateD11Buffer(_gcBlurPassBuffer.p, _cBlurPassBuffer, _context.p);
-	drawPassQuad(entity);
+void DirectX11Renderer::doBrightPass() {
+	drawPassQuad(getScreenPass(ScreenPass::Bright));
 }
 
-void DirectX11Renderer::drawPassQuad(const std::shared_ptr<Entity> e) {
+void DirectX11Renderer::drawPassQuad(const EntityHandle handle) {
+	const auto e = resolve(handle);
 	//Set vertex/index buffers
 	size_t indexCount;
 	{
-		const auto geometry = e->getComponent<GeometryComponent>(COMPONENT_GEOMETRY).lock();
+		const auto geometry = e->get<GeometryComponent>();
 		indexCount = geometry->getIndices().size();
 		auto& gVertices = geometry->getGVertices();
 		auto& gIndices = geometry->getGIndices();
 		UINT stride = geometry->getStride();
 		UINT offset = 0;
-		_context->IASetVertexBuffers(0, 1, &gVertices.p, &stride, &offset);
-		_context->IASetIndexBuffer(gIndices.p, DXGI_FORMAT_R32_UINT, 0);
+		_gfx->setVertexBuffers(0, 1, &gVertices.p, &stride, &offset);
+		_gfx->setIndexBuffer(gIndices.p, DXGI_FORMAT_R32_UINT, 0);
 	}
 	//Set shaders
 	{
-		const auto shader = e->getComponent<ShaderComponent>(COMPONENT_SHADER).lock();
-		shader->use(_context);
+		const auto shader = e->get<ShaderComponent>();
+		_gfx->nativeBind("shader.use", shader, [&](auto& context) { shader->use(context); });
 	}
-	_context->DrawIndexed(indexCount, 0, 0);
+	_gfx->drawIndexed(indexCount, 0, 0);
+}
+
+void DirectX11Renderer::computeFrameMatrices() {
+	//One vectorised pass over every world matrix, draws then just copy their slot out
+	const auto& hierarchy = TransformHierarchy::getInstance();
+	_drawMatrices.resize(hierarchy.size());
+	computeDrawMatrices(hierarchy.getWorldData(), hierarchy.size(), _viewProj, _drawMatrices.data());
+}
+
+const DrawMatrices& DirectX11Renderer::getDrawMatrices(const TransformComponent& transform, DrawMatrices& scratch) const {
+	const int32_t index = transform.getHierarchyIndex();
+	if (index >= 0 && static_cast<size_t>(index) < _drawMatrices.size()) return _drawMatrices[index];
+	//Not awake yet, so not in the hierarchy
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, transform.getTransformAligned());
+	computeDrawMatrices(&world, 1, _viewProj, &scratch);
+	return scratch;
+}
+
+void DirectX11Renderer::cullGeometry() {
+	_frustum = extractFrustum(_viewProj);
+	_bounds.clear();
+	_drawRefs.clear();
+	_drawChunks.clear();
+	size_t staticSignature = 0;
+	forEachArchetype([&](const Archetype& archetype) {
+		const bool instanced = archetype.has(COMPONENT_TERRAIN);
+		for (size_t i = 0; i < archetype.size(); ++i) {
+			const auto sphere = getMeshBounds(*archetype.get<GeometryComponent>(i));
+			const auto world = archetype.get<TransformComponent>(i)->getTransformAligned();
+			if (instanced) {
+				//One sphere per voxel chunk, the mesh bounds swept across the chunk's voxels
+				const auto terrain = archetype.get<TerrainComponent>(i);
+				//A rewind may have swapped the voxel grid out from under the instance buffer
+				if (terrain->consumeGridRestored()) {
+					_gfx->native("terrain.updateInstanceBuffer", [&](auto& context) { terrain->updateInstanceBuffer(context); });
+					staticSignature = ~staticSignature;
+				}
+				//Craters change the instance set, moving the terrain bumps its transform version
+				staticSignature = staticSignature * 31 + terrain->getInstanceCount();
+				staticSignature = staticSignature * 31 + archetype.get<TransformComponent>(i)->getVersion();
+				for (const auto& chunk : terrain->getChunks()) {
+					const auto voxels = boundingSphereFromBox(chunk.min, chunk.max);
+					_bounds.push(transformBoundingSphere(XMFLOAT4(voxels.x + sphere.x, voxels.y + sphere.y, voxels.z + sphere.z, voxels.w + sphere.w), world));
+					_drawRefs.emplace_back(&archetype, i);
+					_drawChunks.push_back(&chunk);
+				}
+				continue;
+			}
+			_bounds.push(transformBoundingSphere(sphere, world));
+			_drawRefs.emplace_back(&archetype, i);
+			_drawChunks.push_back(nullptr);
+		}
+	});
+	_visible.resize(_bounds.size());
+	_visibleCount = cullSpheres(_frustum, _bounds, _visible.data());
+	if (staticSignature != _staticSignature) {
+		_staticSignature = staticSignature;
+		for (auto& cache : _shadowCache) cache.valid = false;
+	}
+}
+
+void DirectX11Renderer::sortVisible() {
+	const auto& view = CameraManager::getInstance().getView();
+	const auto& proj = CameraManager::getInstance().getProjection();
+	const float cameraNear = -proj._43 / proj._33;
+	const float cameraFar = proj._33 * cameraNear / (proj._33 - 1.0f);
+	_drawItems.resize(_visibleCount);
+	for (size_t v = 0; v < _visibleCount; ++v) {
+		const uint32_t index = _visible[v];
+		const auto& archetype = *_drawRefs[index].first;
+		const size_t i = _drawRefs[index].second;
+		const void* textures = archetype.has(COMPONENT_TEXTURE) ? archetype.get<TextureComponent>(i)->getAlbedo().p : nullptr;
+		const void* vertices = archetype.get<GeometryComponent>(i)->getGVertices().p;
+		//View depth of the bounds' centre, front to back within a state group
+		const float depth = _bounds.x[index] * view._13 + _bounds.y[index] * view._23 + _bounds.z[index] * view._33 + view._43;
+		_drawItems[v].key = makeDrawKey(0, getSortId(archetype.get<ShaderComponent>(i)), getSortId(textures), getSortId(vertices), quantiseDepth(depth / cameraFar));
+		_drawItems[v].index = index;
+	}
+	radixSortDraws(_drawItems, _drawScratch);
+}
+
+void DirectX11Renderer::sortCasters(const int light) {
+	auto& items = _shadowItems[light];
+	items.resize(_casterCounts[light]);
+	for (size_t c = 0; c < _casterCounts[light]; ++c) {
+		const uint32_t index = _casters[light][c];
+		const auto& archetype = *_drawRefs[index].first;
+		const size_t i = _drawRefs[index].second;
+		//The shadow map supplies the shaders, so casters only group by variant then mesh
+		const uint32_t variant = archetype.has(COMPONENT_TERRAIN) ? 0 : 1;
+		const void* vertices = archetype.get<GeometryComponent>(i)->getGVertices().p;
+		items[c].key = makeDrawKey(1 + light, variant, 0, getSortId(vertices), 0);
+		items[c].index = index;
+	}
+	radixSortDraws(items, _drawScratch);
+}
+
+bool DirectX11Renderer::isInstanceable(const uint32_t index) const {
+	//Without a device there's no instance buffer to read from
+	if (!_instancing || !_graphicsDevice) return false;
+	const auto& archetype = *_drawRefs[index].first;
+	//Terrain brings its own per-voxel instance buffer
+	if (archetype.has(COMPONENT_TERRAIN)) return false;
+	return archetype.get<RenderComponent>(_drawRefs[index].second)->getRenderType() == RenderType::Render_InstancedIndexed;
+}
+
+bool DirectX11Renderer::isSameBatch(const uint32_t a, const uint32_t b) const {
+	const auto& first = _drawRefs[a];
+	const auto& second = _drawRefs[b];
+	if (first.first->get<GeometryComponent>(first.second)->getGVertices().p != second.first->get<GeometryComponent>(second.second)->getGVertices().p) return false;
+	if (first.first->get<ShaderComponent>(first.second) != second.first->get<ShaderComponent>(second.second)) return false;
+	const bool textured = first.first->has(COMPONENT_TEXTURE);
+	if (textured != second.first->has(COMPONENT_TEXTURE)) return false;
+	return !textured || first.first->get<TextureComponent>(first.second)->getAlbedo().p == second.first->get<TextureComponent>(second.second)->getAlbedo().p;
+}
+
+void DirectX11Renderer::batchDraws(const std::vector<DrawItem>& items, const bool instanced, std::vector<DrawBatch>& batches) {
+	batches.clear();
+	//Sorting put draws of the same mesh (and material) next to each other, each run becomes one draw
+	for (size_t b = 0; b < items.size();) {
+		size_t e = b + 1;
+		if (instanced && isInstanceable(items[b].index)) {
+			const uint64_t group = items[b].key >> SORT_DEPTH_BITS;
+			while (e < items.size() && (items[e].key >> SORT_DEPTH_BITS) == group && isInstanceable(items[e].index)
+				&& isSameBatch(items[b].index, items[e].index)) ++e;
+		}
+		const DrawBatch batch = { b, e - b, static_cast<UINT>(_instanceData.size()) };
+		if (batch.count > 1) {
+			for (size_t d = b; d < e; ++d) {
+				const auto& archetype = *_drawRefs[items[d].index].first;
+				const size_t i = _drawRefs[items[d].index].second;
+				const auto render = archetype.get<RenderComponent>(i);
+				const auto& matrices = getDrawMatrices(*archetype.get<TransformComponent>(i), _unsortedDrawMatrices);
+				_instanceData.push_back({ matrices.m, matrices.mvp, XMFLOAT4(0, render->isHDR() ? 1.0f : 0.0f, render->isAnimated() ? 1.0f : 0.0f, 0) });
+			}
+		}
+		batches.push_back(batch);
+		b = e;
+	}
+}
+
+void DirectX11Renderer::batchFrame() {
+	//Every pass batches before any of them draws, so the frame's instance data goes up in one upload
+	_instanceData.clear();
+	sortVisible();
+	batchDraws(_drawItems, true, _batches);
+	for (int light = 0; light < 2; ++light) {
+		sortCasters(light);
+		//The shadow map's depth shaders don't read the instance buffer, every caster is its own draw
+		batchDraws(_shadowItems[light], false, _shadowBatches[light]);
+	}
+	if (_instanceData.empty()) return;
+	if (!_instances.reserve(*_graphicsDevice, _instanceData.size())) throw std::exception("[E] Creating instance buffer in DirectX11Renderer.");
+	_instances.upload(_instanceData, *_gfx);
+}
+
+uint32_t DirectX11Renderer::getSortId(const void* object) {
+	return _sortIds.get(object);
+}
+
+void DirectX11Renderer::updateLightMatrices() {
+	//World-space corners of the slice of the camera frustum that receives shadows
+	XMVECTOR corners[8];
+	{
+		const auto& proj = CameraManager::getInstance().getProjection();
+		const float cameraNear = -proj._43 / proj._33;
+		const float cameraFar = proj._33 * cameraNear / (proj._33 - 1.0f);
+		const float sliceFar = std::min(cameraFar, _shadowDistance);
+		const float farNdc = proj._33 + proj._43 / sliceFar;
+		const auto invViewProj = XMMatrixInverse(nullptr, XMLoadFloat4x4(&_viewProj));
+		for (int c = 0; c < 8; ++c) {
+			const auto ndc = XMVectorSet(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? farNdc : 0.0f, 1.0f);
+			corners[c] = XMVector3TransformCoord(ndc, invViewProj);
+		}
+	}
+	//A sphere rather than a box around the slice, so its size doesn't change as the camera turns
+	auto centre = XMVectorZero();
+	for (const auto& corner : corners) centre = XMVectorAdd(centre, corner);
+	centre = XMVectorScale(centre, 1.0f / 8.0f);
+	float radius = 0;
+	for (const auto& corner : corners)
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(XMVectorSubtract(corner, centre))));
+	//Padded by the slack so the slice can move inside it for a while
+	const float fitRadius = std::ceil(radius * (1.0f + _shadowFitSlack) * 16.0f) / 16.0f;
+	const float texel = 2.0f * fitRadius / _shadowResolution;
+
+	for (int i = 0; i < 2; ++i) {
+		auto light = resolve(_lights[i]);
+		auto transform = light->get<TransformComponent>();
+		auto& pos = transform->getPosition();
+		XMStoreFloat4(&_cLightBuffer.light[i].position, XMLoadFloat3(&pos));
+		auto lo = transform->getOrientation();
+		auto lightOrientationMat = XMMatrixRotationQuaternion(XMLoadFloat4(&lo));
+		auto lightView = XMMatrixLookAtLH(XMLoadFloat4(&_cLightBuffer.light[i].position), XMVectorSet(0, 0, 0, 1),
+			XMVector3Transform(XMVectorSet(0, 1, 0, 1), lightOrientationMat));
+
+		//The fit is held while the slice stays inside it, so the cached static layer survives small camera
+		//moves. Once the slice leaves it's refitted around the slice, snapped to whole shadow map texels.
+		auto& cache = _shadowCache[i];
+		auto& fit = cache.fit;
+		XMFLOAT3 sliceLS;
+		XMStoreFloat3(&sliceLS, XMVector3Transform(centre, lightView));
+		const bool refit = fit.w != fitRadius || std::fabs(sliceLS.x - fit.x) + radius > fit.w
+			|| std::fabs(sliceLS.y - fit.y) + radius > fit.w || std::fabs(sliceLS.z - fit.z) + radius > fit.w;
+		if (refit) fit = XMFLOAT4(std::floor(sliceLS.x / texel) * texel, std::floor(sliceLS.y / texel) * texel, sliceLS.z, fitRadius);
+
+		//Pull the near plane back to the furthest caster towards the light, casters outside the slice still
+		//shade it. Only spheres over the fitted square can cast into it, the rest would just waste depth range.
+		float nearZ = fit.z - fit.w;
+		bool pulled = false;
+		for (size_t b = 0; b < _bounds.size(); ++b) {
+			XMFLOAT3 ls;
+			XMStoreFloat3(&ls, XMVector3Transform(XMVectorSet(_bounds.x[b], _bounds.y[b], _bounds.z[b], 1), lightView));
+			const float reach = fit.w + _bounds.radius[b];
+			if (std::fabs(ls.x - fit.x) > reach || std::fabs(ls.y - fit.y) > reach) continue;
+			if (ls.z - _bounds.radius[b] < nearZ) {
+				nearZ = ls.z - _bounds.radius[b];
+				pulled = true;
+			}
+		}
+		//Held as well, it only moves when a caster comes nearer. A caster pulling it gets some slack too.
+		if (refit || nearZ < cache.nearZ) cache.nearZ = pulled ? nearZ - _shadowFitSlack * fit.w : nearZ;
+		auto lightProj = XMMatrixOrthographicOffCenterLH(fit.x - fit.w, fit.x + fit.w,
+			fit.y - fit.w, fit.y + fit.w, cache.nearZ, fit.z + fit.w);
+		const auto lightViewProj = XMMatrixMultiply(lightView, lightProj);
+		XMStoreFloat4x4(&_cLightBuffer.light[i].viewProj, XMMatrixTranspose(lightViewProj));
+
+		XMFLOAT4X4 lightViewProjF;
+		XMStoreFloat4x4(&lightViewProjF, lightViewProj);
+		//The static layer survives small light moves, past the threshold it's redrawn
+		for (int e = 0; e < 16 && cache.valid; ++e)
+			if (std::fabs((&lightViewProjF._11)[e] - (&cache.viewProj._11)[e]) > _shadowCacheThreshold) cache.valid = false;
+		if (!cache.valid) cache.viewProj = lightViewProjF;
+
+		//Per-light caster culling, shadow draws scale with the shadowed region not the scene
+		_casters[i].resize(_bounds.size());
+		_casterCounts[i] = cullSpheres(extractFrustum(lightViewProjF), _bounds, _casters[i].data());
+	}
+	_gcLightBuffer.update(_cLightBuffer, *_gfx);
+}
+
+const XMFLOAT4& DirectX11Renderer::getMeshBounds(GeometryComponent& geometry) {
+	const auto& vertices = geometry.getVertices();
+	auto& cached = _meshBounds[&geometry];
+	//Vertex count guards against a new mesh reusing a freed component's address
+	if (cached.first != vertices.size() || cached.second.w == 0) {
+		cached.first = vertices.size();
+		cached.second = computeBoundingSphere(vertices);
+	}
+	return cached.second;
 }
 
 void DirectX11Renderer::createConstantBuffers()
 {
-	D3D11_BUFFER_DESC bd = {};
-	bd.Usage = D3D11_USAGE_DYNAMIC;
-	bd.ByteWidth = sizeof(UpdateFrameBuffer);
-	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	HRESULT hr = _device->CreateBuffer(&bd, nullptr, &_gcUpdateBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating Update frame Buffer in DirectX11Renderer.cpp");
+	if (!_gcUpdateBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating Update frame Buffer in DirectX11Renderer.cpp");
 
-	bd.ByteWidth = sizeof(DrawFrameBuffer);
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcDrawBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating Draw frame Buffer in DirectX11Renderer.cpp");
+	if (!_gcDrawBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating Draw frame Buffer in DirectX11Renderer.cpp");
 
-	bd.ByteWidth = sizeof(MiscCBuffer);
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcRenderStateCBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating Render state Buffer in DirectX11Renderer.cpp");
+	if (!_gcRenderStateCBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating Render state Buffer in DirectX11Renderer.cpp");
 
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcMRTBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating MRT Buffer in DirectX11Renderer.cpp");
+	if (!_gcMRTBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating MRT Buffer in DirectX11Renderer.cpp");
 
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcBlurPassBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating Blur Pass Buffer in DirectX11Renderer.cpp");
+	if (!_gcBlurPassBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating Blur Pass Buffer in DirectX11Renderer.cpp");
 
-	bd.ByteWidth = sizeof(ViewProjBuffer);
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcVPBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating VP Buffer in DirectX11Renderer.cpp");
+	if (!_gcVPBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating VP Buffer in DirectX11Renderer.cpp");
 
-	bd.ByteWidth = sizeof(ParticleBuffer);
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcParticleBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating Particle Buffer in DirectX11Renderer.cpp");
+	if (!_gcParticleBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating Particle Buffer in DirectX11Renderer.cpp");
 
-	bd.ByteWidth = sizeof(LightCBuffer);
-	hr = _device->CreateBuffer(&bd, nullptr, &_gcLightBuffer.p);
-	if (FAILED(hr)) throw std::exception("[E] Creating VP Buffer in DirectX11Renderer.cpp");
+	if (!_gcLightBuffer.create(*_graphicsDevice)) throw std::exception("[E] Creating VP Buffer in DirectX11Renderer.cpp");
+
+	//Pre D3D11.1 devices keep uploading per-draw constants into the tracked buffers
+	_constantRing.create(_graphicsDevice.get(), CONSTANT_RING_SIZE, 3);
 
 }	
 
+void DirectX11Renderer::createDeferredContexts()
+{
+	//One per pool worker plus the thread that waits on them, which records a slice too
+	_recorder.create(_device, ThreadPool::getInstance().workerCount() + 1, DEFERRED_RING_SIZE);
+	_drawStates.resize(_recorder.size() + 1);
+	for (auto& state : _drawStates) {
+		if (!state.buffer.create(*_graphicsDevice)) throw std::exception("[E] Creating per-thread Draw frame Buffer in DirectX11Renderer.cpp");
+	}
+}
+
 void DirectX11Renderer::createRasterStates()
 {
 	D3D11_RASTERIZER_DESC rd{};
@@ -469,12 +795,135 @@ void DirectX11Renderer::createRasterStates()
 	if (FAILED(hr)) throw std::exception("[E] Creating RasterState Quad.");
 }
 
+void DirectX11Renderer::buildRenderGraph(const UINT width, const UINT height)
+{
+	//Kept so quality settings can rebuild the graph later
+	this->width = width;
+	this->height = height;
+	_graph = RenderGraph();
+	_graph.setBackBuffer(_renderTargetView.p);
+	_rgDepth = _graph.importResource("depth");
+	_rgSunDepth = _graph.importResource("sunDepth");
+	_rgMoonDepth = _graph.importResource("moonDepth");
+	RGTextureDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.mips = true;
+	_rgLit = _graph.createTexture("lit", desc);
+	desc.mips = false;
+	_rgComposite = _graph.createTexture("composite", desc);
+	desc.format = _gbufferLayout.albedo;
+	_rgAlbedo = _graph.createTexture("albedo", desc);
+	desc.format = _gbufferLayout.normal;
+	_rgNormal = _graph.createTexture("normal", desc);
+	desc.format = _gbufferLayout.hdr;
+	_rgHDR = _graph.createTexture("hdr", desc);
+	//Bloom thresholds into half resolution then works down a chain of halving levels
+	RGTextureDesc bloomDesc;
+	bloomDesc.format = BLOOM_FORMAT;
+	_rgBloom.clear();
+	_rgBloomH.clear();
+	for (UINT level = 0; level < _bloomLevels; ++level) {
+		bloomDesc.width = std::max(1u, width >> (level + 1));
+		bloomDesc.height = std::max(1u, height >> (level + 1));
+		if (level == 0) _rgBright = _graph.createTexture("bright", bloomDesc);
+		_rgBloomH.push_back(_graph.createTexture(("bloomH" + std::to_string(level)).c_str(), bloomDesc));
+		_rgBloom.push_back(_graph.createTexture(("bloom" + std::to_string(level)).c_str(), bloomDesc));
+	}
+
+	const FLOAT* clear = DirectX::Colors::CornflowerBlue;
+	const FLOAT* black = DirectX::Colors::Black;
+	_graph.addPass("geometry")
+		.writes(_rgAlbedo, black)
+		.writes(_rgNormal, black)
+		.writes(_rgHDR, black)
+		.writes(_rgDepth)
+		.depthStencil(_depthStencilView.p)
+		.execute([this]() {
+			_gfx->clearDepthStencil(_depthStencilView.p, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+			doGeometryPass();
+			//doAnyParticleSystems();
+		});
+	_graph.addPass("sunShadow")
+		.writes(_rgSunDepth)
+		.execute([this]() { doShadowPass(*_sunlight, 0); });
+	_graph.addPass("moonShadow")
+		.writes(_rgMoonDepth)
+		.execute([this]() { doShadowPass(*_moonlight, 1); });
+	_graph.addPass("light")
+		.reads(_rgAlbedo, 0)
+		.reads(_rgNormal, 1)
+		.reads(_rgHDR, 2)
+		.reads(_rgSunDepth, 3)
+		.reads(_rgMoonDepth, 4)
+		.reads(_rgDepth, 5)
+		.writes(_rgLit, clear)
+		.execute([this]() { doLightPass(); });
+	_graph.addPass("bright")
+		.reads(_rgLit, 0) // Lit Scene Slot 0
+		.writes(_rgBright)
+		.execute([this]() { doBrightPass(); });
+	//Down: each level blurs the one above it, the horizontal pass doing the downsample
+	for (UINT level = 0; level < _bloomLevels; ++level) {
+		const auto source = level == 0 ? _rgBright : _rgBloom[level - 1];
+		const UINT sourceWidth = std::max(1u, width >> (level == 0 ? 1 : level));
+		const UINT sourceHeight = std::max(1u, height >> (level == 0 ? 1 : level));
+		const UINT levelWidth = std::max(1u, width >> (level + 1));
+		const UINT levelHeight = std::max(1u, height >> (level + 1));
+		_graph.addPass(("bloomH" + std::to_string(level)).c_str())
+			.reads(source, 1) // Level above Slot 1
+			.writes(_rgBloomH[level])
+			.execute([this, sourceWidth, sourceHeight]() { doBlurPass(1, 0, sourceWidth, sourceHeight); });
+		_graph.addPass(("bloomV" + std::to_string(level)).c_str())
+			.reads(_rgBloomH[level], 1)
+			.writes(_rgBloom[level])
+			.execute([this, levelWidth, levelHeight]() { doBlurPass(0, 1, levelWidth, levelHeight); });
+	}
+	//Up: each level is added into the one above, so level 0 ends up holding every width of glow
+	for (UINT level = _bloomLevels - 1; level-- > 0;) {
+		const UINT sourceWidth = std::max(1u, width >> (level + 2));
+		const UINT sourceHeight = std::max(1u, height >> (level + 2));
+		_graph.addPass(("bloomUp" + std::to_string(level)).c_str())
+			.reads(_rgBloom[level + 1], 1)
+			.writes(_rgBloom[level])
+			.execute([this, sourceWidth, sourceHeight]() { doBloomUpsamplePass(sourceWidth, sourceHeight); });
+	}
+	_graph.addPass("final")
+		.reads(_rgLit, 0)
+		.reads(_rgBloom[0], 1) // Blurred Image Slot 1
+		.writes(_rgComposite, clear)
+		.execute([this]() { doFinalPass(); });
+}
+
+void DirectX11Renderer::setBloomLevels(const UINT levels)
+{
+	const UINT clamped = std::min(std::max(levels, 1u), MAX_BLOOM_LEVELS);
+	if (clamped == _bloomLevels) return;
+	_bloomLevels = clamped;
+	//Before setDirectXModules there's no graph to rebuild yet
+	if (width > 0 && height > 0) buildRenderGraph(width, height);
+}
+
+void DirectX11Renderer::setGBufferLayout(const GBufferLayout& layout)
+{
+	_gbufferLayout = layout;
+	if (width > 0 && height > 0) buildRenderGraph(width, height);
+}
+
+void DirectX11Renderer::setGraphicsContext(const std::shared_ptr<GraphicsContext> gfx)
+{
+	_stateFilter = std::make_shared<FilteringGraphicsContext>(gfx);
+	_gfx = _stateFilter;
+}
+
 void DirectX11Renderer::setDirectXModules(const std::weak_ptr<DirectX11Manager> weakD3dManager)
 { 
 	auto manager = weakD3dManager.lock();
 	_swapChain = manager->getSwapChain();
 	_device = manager->getDevice();
 	_context = manager->getContext();
+	setGraphicsContext(std::make_shared<D3D11GraphicsContext>(_context));
+	_graphicsDevice = std::make_shared<D3D11GraphicsDevice>(_device);
 	UINT width = manager->getWidth();
 	UINT height = manager->getHeight();
 	
@@ -500,8 +949,9 @@ void DirectX11Renderer::setDirectXModules(const std::weak_ptr<DirectX11Manager>
 	depthTextureDesc.SampleDesc.Count = 1;
 	depthTextureDesc.SampleDesc.Quality = 0;
 	depthTextureDesc.Usage = D3D11_USAGE_DEFAULT;
-	depthTextureDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthTextureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	//Typeless so the light pass can read depth back and rebuild positions from it
+	depthTextureDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
+	depthTextureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
 
 	ID3D11Texture2D* DepthStencilTexture = {};
 	HRESULT hr = _device->CreateTexture2D(&depthTextureDesc, NULL, &DepthStencilTexture);
@@ -509,11 +959,18 @@ void DirectX11Renderer::setDirectXModules(const std::weak_ptr<DirectX11Manager>
 
 	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
 	ZeroMemory(&dsvDesc, sizeof(dsvDesc));
-	dsvDesc.Format = depthTextureDesc.Format;
-	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DMS;
+	dsvDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
 	hr = _device->CreateDepthStencilView(DepthStencilTexture, &dsvDesc, &_depthStencilView.p);
+	if (FAILED(hr)) { DepthStencilTexture->Release(); throw std::exception("[E] Creating Depth stencil view DirectX11Renderer."); }
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC depthSRVDesc = {};
+	depthSRVDesc.Format = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+	depthSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	depthSRVDesc.Texture2D.MipLevels = 1;
+	hr = _device->CreateShaderResourceView(DepthStencilTexture, &depthSRVDesc, &_depthStencilSRV.p);
 	DepthStencilTexture->Release();
-	if (FAILED(hr)) throw std::exception("[E] Creating Depth stencil view DirectX11Renderer.");
+	if (FAILED(hr)) throw std::exception("[E] Creating depth shader resource view DirectX11Renderer.");
 
 	CComPtr<ID3D11Texture2D> backBuffer;
 	hr = _swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer.p));
@@ -523,15 +980,7 @@ void DirectX11Renderer::setDirectXModules(const std::weak_ptr<DirectX11Manager>
 	if (FAILED(hr)) throw std::exception("[E] Creating RTV from BackBuffer DirectX11Renderer");
 	manager->getContext()->OMSetRenderTargets(1, &_renderTargetView.p, nullptr);
 
-	//Create GBuffer
-	_gbuffer = GBuffer(3, _device, width, height);
-
-	_cBlurPassBuffer.misc.z = width;
-	_cBlurPassBuffer.misc.w = height;
-	createGBuffer(_device, width, height, _lightPassOutput);
-	createGBuffer(_device, width, height, _blurPassOutput);
-	createGBuffer(_device, width, height, _brightPassOutput);
-
+	buildRenderGraph(width, height);
 
 	D3D11_DEPTH_STENCIL_DESC dsDesc;
 	ZeroMemory(&dsDesc, sizeof(dsDesc));
@@ -539,4 +988,17 @@ void DirectX11Renderer::setDirectXModules(const std::weak_ptr<DirectX11Manager>
 	hr = _device->CreateDepthStencilState(&dsDesc, &_depthDisabledState.p);
 	if (FAILED(hr)) { throw std::exception("[E] Creating depth stencil state in EmitterComponent"); }
 
+	//Bloom upsampling adds each level onto the one above
+	D3D11_BLEND_DESC bd = {};
+	bd.RenderTarget[0].BlendEnable = true;
+	bd.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	hr = _device->CreateBlendState(&bd, &_additiveBlendState.p);
+	if (FAILED(hr)) { throw std::exception("[E] Creating additive blend state in DirectX11Renderer"); }
+
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "DrawSort.h"
+#include <algorithm>
+
+uint32_t SortIdTable::get(const void* object)
+{
+	if (!object) return 0;
+	auto hash = reinterpret_cast<uintptr_t>(object);
+	hash ^= hash >> 17;
+	hash *= 0x9E3779B97F4A7C15ull;
+	//Nothing is removed mid-frame, so an object's entry is never past the first stale slot on its probe
+	for (size_t i = static_cast<size_t>(hash >> 20) & (CAPACITY - 1);; i = (i + 1) & (CAPACITY - 1)) {
+		auto& entry = _entries[i];
+		if (entry.frame != _frame) {
+			//Saturated, and not inserted either so the table can never fill
+			if (_count >= MAX_IDS) return MAX_IDS;
+			entry = Entry{ object, ++_count, _frame };
+			return entry.id;
+		}
+		if (entry.object == object) return entry.id;
+	}
+}
+
+void SortIdTable::beginFrame()
+{
+	_count = 0;
+	if (++_frame != 0) return;
+	//Wrapped, stamps from 2^32 frames ago would look current
+	std::fill(_entries.begin(), _entries.end(), Entry{ nullptr, 0, 0 });
+	_frame = 1;
+}
+
+void radixSortDraws(std::vector<DrawItem>& items, std::vector<DrawItem>& scratch)
+{
+	const size_t count = items.size();
+	if (count < 2) return;
+	scratch.resize(count);
+
+	//Every byte's histogram in one read over the keys
+	size_t histograms[8][256] = {};
+	for (const auto& item : items)
+		for (int b = 0; b < 8; ++b) ++histograms[b][(item.key >> (b * 8)) & 0xff];
+
+	auto* source = &items;
+	auto* destination = &scratch;
+	for (int b = 0; b < 8; ++b) {
+		auto& histogram = histograms[b];
+		//All keys share this byte, the pass wouldn't move anything
+		if (histogram[(items[0].key >> (b * 8)) & 0xff] == count) continue;
+		size_t offset = 0;
+		for (auto& bucket : histogram) {
+			const size_t n = bucket;
+			bucket = offset;
+			offset += n;
+		}
+		for (const auto& item : *source)
+			(*destination)[histogram[(item.key >> (b * 8)) & 0xff]++] = item;
+		std::swap(source, destination);
+	}
+	if (source != &items) items.swap(scratch);
+}
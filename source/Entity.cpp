@@ -1,7 +1,15 @@
 #include "Entity.h"
+#include "ArchetypeStore.h"
+#include "EntityRegistry.h"
 
-Entity::Entity(const char* name, const uint8_t id) : _name(name), _id(id), _mask(0)
+Entity::Entity(const char* name, const EntityHandle id) : _name(name), _id(id), _mask(0), _archetype(nullptr), _row(0)
 { 
+	_slots.fill(nullptr);
+}
+
+Entity::~Entity()
+{
+	ArchetypeStore::getInstance().remove(*this);
 }
 
 void Entity::awake(const CComPtr<ID3D11Device>& device) {
@@ -16,11 +24,41 @@ void Entity::addComponent(const std::shared_ptr<AComponent> component)
 	if (_components.count(newComponentType) != 0) {
 		return;
 	}
+	const auto oldMask = _mask;
 	_components[newComponentType]=component;
+	_slots[componentIndex(newComponentType)] = component.get();
 	_mask |= newComponentType;
+	EntityRegistry::getInstance().onMaskChanged(*this, oldMask);
 }
 
 void Entity::removeComponent(ComponentType type)
 {
-	if (_components.erase(type) != 0) _mask ^= type; 
-}
\ No newline at end of file
+	if (_components.erase(type) == 0) return;
+	_slots[componentIndex(type)] = nullptr;
+	const auto oldMask = _mask;
+	_mask ^= type;
+	EntityRegistry::getInstance().onMaskChanged(*this, oldMask);
+}
+void Entity::changeComponents(const uint16_t removeMask, const std::vector<std::shared_ptr<AComponent>>& adds, const CComPtr<ID3D11Device>& device)
+{
+	const auto oldMask = _mask;
+	for (size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i) {
+		const auto type = static_cast<ComponentType>(1 << i);
+		if ((removeMask & type) == 0 || _components.erase(type) == 0) continue;
+		_slots[i] = nullptr;
+		_mask ^= type;
+	}
+	for (const auto& component : adds) {
+		const auto type = component->getType();
+		if (_components.count(type) != 0) continue;
+		_components[type] = component;
+		_slots[componentIndex(type)] = component.get();
+		_mask |= type;
+	}
+	//Only once every add is slotted, so a component can find its siblings while awaking
+	for (const auto& component : adds)
+		if (_slots[componentIndex(component->getType())] == component.get())
+			component->onAwake(*this, device);
+	if (_mask != oldMask)
+		EntityRegistry::getInstance().onMaskChanged(*this, oldMask);
+}
@@ -0,0 +1,40 @@
+#include "EntityQuery.h"
+#include "Systems/ASystem.h"
+
+EntityQuery::EntityQuery(const uint16_t mask, ASystem* listener) : _mask(mask), _listener(listener)
+{
+}
+
+void EntityQuery::insert(const EntityHandle handle)
+{
+	if (contains(handle)) return;
+	const auto index = handle.index();
+	if (index >= _slots.size()) _slots.resize(index + 1, INVALID_SLOT);
+	_slots[index] = static_cast<uint32_t>(_handles.size());
+	_handles.push_back(handle);
+	if (_listener) _listener->onEntityAdded(handle);
+}
+
+void EntityQuery::erase(const EntityHandle handle)
+{
+	if (!contains(handle)) return;
+	const auto slot = _slots[handle.index()];
+	const auto last = _handles.back();
+	_handles[slot] = last;
+	_slots[last.index()] = slot;
+	_handles.pop_back();
+	_slots[handle.index()] = INVALID_SLOT;
+	if (_listener) _listener->onEntityRemoved(handle);
+}
+
+void EntityQuery::changed(const EntityHandle handle, const uint16_t oldMask, const uint16_t newMask)
+{
+	if (_listener && contains(handle))
+		_listener->onComponentsChanged(handle, newMask & ~oldMask, oldMask & ~newMask);
+}
+
+void EntityQuery::addArchetype(Archetype& archetype)
+{
+	if (matches(archetype.getMask()))
+		_archetypes.push_back(&archetype);
+}
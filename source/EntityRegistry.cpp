@@ -0,0 +1,130 @@
+#include "EntityRegistry.h"
+#include <algorithm>
+#include "Entity.h"
+#include "ArchetypeStore.h"
+#include "SceneArena.h"
+
+EntityRegistry::~EntityRegistry()
+{
+	clear();
+}
+
+EntityHandle EntityRegistry::create(const char* name)
+{
+	const auto handle = reserve();
+	create(handle, name);
+	return handle;
+}
+
+EntityHandle EntityRegistry::reserve()
+{
+	std::lock_guard<std::mutex> guard(_reserveLock);
+	if (!_freeIndices.empty()) {
+		const auto index = _freeIndices.back();
+		_freeIndices.pop_back();
+		return EntityHandle(index, _generations[index]);
+	}
+	//Indices past the end aren't added to the sparse array until created, readers may be iterating it
+	const auto index = static_cast<uint32_t>(_sparse.size()) + _reservedTail;
+	if (index >= EntityHandle::MAX_ENTITIES) throw std::exception("[E] Entity limit reached in EntityRegistry.");
+	++_reservedTail;
+	return EntityHandle(index, 0);
+}
+
+void EntityRegistry::growTo(const uint32_t index)
+{
+	if (index < _sparse.size()) return;
+	const auto grown = index + 1 - static_cast<uint32_t>(_sparse.size());
+	_sparse.resize(index + 1, INVALID_SLOT);
+	_generations.resize(index + 1, 0);
+	_reservedTail -= grown;
+}
+
+void EntityRegistry::create(const EntityHandle reserved, const char* name)
+{
+	const auto index = reserved.index();
+	{
+		//reserve() reads the tail from worker threads
+		std::lock_guard<std::mutex> guard(_reserveLock);
+		growTo(index);
+	}
+	_sparse[index] = static_cast<uint32_t>(_dense.size());
+	_dense.push_back(reserved);
+	_entities.push_back(SceneArena::getInstance().create<Entity>(name, reserved));
+}
+
+void EntityRegistry::release(const EntityHandle reserved)
+{
+	std::lock_guard<std::mutex> guard(_reserveLock);
+	growTo(reserved.index());
+	_freeIndices.push_back(reserved.index());
+}
+
+void EntityRegistry::destroy(const EntityHandle handle)
+{
+	if (!isAlive(handle)) return;
+	const auto index = handle.index();
+	const auto slot = _sparse[index];
+	const auto mask = _entities[slot]->getMask();
+	for (auto& query : _queries)
+		if (query->matches(mask)) query->erase(handle);
+	SceneArena::getInstance().destroy(_entities[slot]);
+	const auto last = static_cast<uint32_t>(_dense.size() - 1);
+	if (slot != last) {
+		_dense[slot] = _dense[last];
+		_entities[slot] = _entities[last];
+		_sparse[_dense[slot].index()] = slot;
+	}
+	_dense.pop_back();
+	_entities.pop_back();
+	_sparse[index] = INVALID_SLOT;
+	std::lock_guard<std::mutex> guard(_reserveLock);
+	_generations[index] = (_generations[index] + 1) & EntityHandle::GENERATION_MASK;
+	_freeIndices.push_back(index);
+}
+
+void EntityRegistry::clear()
+{
+	while (!_dense.empty())
+		destroy(_dense.back());
+}
+
+EntityQuery& EntityRegistry::registerQuery(const uint16_t mask, ASystem* listener)
+{
+	auto query = std::make_unique<EntityQuery>(mask, nullptr);
+	for (size_t i = 0; i < _dense.size(); ++i)
+		if (query->matches(_entities[i]->getMask())) query->insert(_dense[i]);
+	for (auto* archetype : ArchetypeStore::getInstance().getArchetypes())
+		query->addArchetype(*archetype);
+	query->_listener = listener;
+	_queries.push_back(std::move(query));
+	return *_queries.back();
+}
+
+void EntityRegistry::unregisterQuery(const EntityQuery& query)
+{
+	_queries.erase(std::remove_if(_queries.begin(), _queries.end(),
+		[&](const std::unique_ptr<EntityQuery>& q) { return q.get() == &query; }), _queries.end());
+}
+
+//Moves the entity to its new archetype and patches only the queries whose match changed,
+//queries it still matches are told which components came and went.
+void EntityRegistry::onMaskChanged(Entity& e, const uint16_t oldMask)
+{
+	ArchetypeStore::getInstance().onMaskChanged(e);
+	const auto newMask = e.getMask();
+	for (auto& query : _queries) {
+		const bool was = query->matches(oldMask);
+		const bool is = query->matches(newMask);
+		if (was && is && oldMask != newMask) query->changed(e.getId(), oldMask, newMask);
+		if (was == is) continue;
+		if (is) query->insert(e.getId());
+		else query->erase(e.getId());
+	}
+}
+
+void EntityRegistry::onArchetypeCreated(Archetype& archetype)
+{
+	for (auto& query : _queries)
+		query->addArchetype(archetype);
+}
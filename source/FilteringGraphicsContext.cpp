@@ -0,0 +1,164 @@
+#include "FilteringGraphicsContext.h"
+#include <cstring>
+
+void FilteringGraphicsContext::invalidate()
+{
+	_targets.known = false;
+	for (uint32_t i = 0; i < SLOTS; ++i) {
+		_vsCBs[i].known = _psCBs[i].known = false;
+		_vertexBuffers[i].known = false;
+	}
+	forgetShaderResources();
+	_indexBuffer.known = false;
+	_rasterizer.known = false;
+	_viewport.known = false;
+	_blend.known = false;
+	_depth.known = false;
+	_nativeBinds.clear();
+}
+
+void FilteringGraphicsContext::forgetShaderResources()
+{
+	for (uint32_t i = 0; i < SLOTS; ++i) _vsSRVs[i].known = _psSRVs[i].known = false;
+}
+
+void FilteringGraphicsContext::onNative(const char* label)
+{
+	invalidate();
+	_inner->onNative(label);
+}
+
+bool FilteringGraphicsContext::onNativeBind(const char* label, const void* object)
+{
+	for (auto& bind : _nativeBinds) {
+		if (strcmp(bind.first, label) != 0) continue;
+		if (bind.second == object) { ++_frame.elided; return false; }
+		bind.second = object;
+		++_frame.issued;
+		return _inner->onNativeBind(label, object);
+	}
+	_nativeBinds.emplace_back(label, object);
+	++_frame.issued;
+	return _inner->onNativeBind(label, object);
+}
+
+void FilteringGraphicsContext::setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv)
+{
+	TargetBinding binding = {};
+	binding.count = count < MAX_TARGETS ? count : MAX_TARGETS;
+	for (uint32_t i = 0; i < binding.count; ++i) binding.rtvs[i] = rtvs ? rtvs[i] : nullptr;
+	binding.dsv = dsv;
+	if (!filter(_targets, binding)) return;
+	_inner->setRenderTargets(count, rtvs, dsv);
+	//Binding an RTV makes the runtime unbind any SRVs that alias it, so the tracked SRVs may be stale
+	forgetShaderResources();
+}
+
+void FilteringGraphicsContext::setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers)
+{
+	uint32_t first, last;
+	if (narrow(_vsCBs, slot, count, [&](const uint32_t i) { return buffers[i]; }, first, last))
+		_inner->setVSConstantBuffers(slot + first, last - first, buffers + first);
+}
+
+void FilteringGraphicsContext::setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers)
+{
+	uint32_t first, last;
+	if (narrow(_psCBs, slot, count, [&](const uint32_t i) { return buffers[i]; }, first, last))
+		_inner->setPSConstantBuffers(slot + first, last - first, buffers + first);
+}
+
+void FilteringGraphicsContext::setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	//Offsets move every draw, just make sure a later whole-buffer bind of the same buffer isn't dropped
+	for (uint32_t i = 0; i < count && slot + i < SLOTS; ++i) _vsCBs[slot + i].known = false;
+	++_frame.issued;
+	_inner->setVSConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+}
+
+void FilteringGraphicsContext::setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	for (uint32_t i = 0; i < count && slot + i < SLOTS; ++i) _psCBs[slot + i].known = false;
+	++_frame.issued;
+	_inner->setPSConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+}
+
+void FilteringGraphicsContext::setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs)
+{
+	uint32_t first, last;
+	if (!narrow(_vsSRVs, slot, count, [&](const uint32_t i) { return srvs[i]; }, first, last)) return;
+	_inner->setVSShaderResources(slot + first, last - first, srvs + first);
+	//Binding an SRV makes the runtime unbind any RTV that aliases it, so the tracked targets may be stale
+	_targets.known = false;
+}
+
+void FilteringGraphicsContext::setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs)
+{
+	uint32_t first, last;
+	if (!narrow(_psSRVs, slot, count, [&](const uint32_t i) { return srvs[i]; }, first, last)) return;
+	_inner->setPSShaderResources(slot + first, last - first, srvs + first);
+	//Binding an SRV makes the runtime unbind any RTV that aliases it, so the tracked targets may be stale
+	_targets.known = false;
+}
+
+void FilteringGraphicsContext::setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+	uint32_t first, last;
+	if (narrow(_vertexBuffers, slot, count, [&](const uint32_t i) { return VertexBinding{ buffers[i], strides[i], offsets[i] }; }, first, last))
+		_inner->setVertexBuffers(slot + first, last - first, buffers + first, strides + first, offsets + first);
+}
+
+void FilteringGraphicsContext::setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset)
+{
+	if (filter(_indexBuffer, IndexBinding{ buffer, format, offset })) _inner->setIndexBuffer(buffer, format, offset);
+}
+
+void FilteringGraphicsContext::setRasterizerState(GraphicsRasterizerState* state)
+{
+	if (filter(_rasterizer, state)) _inner->setRasterizerState(state);
+}
+
+void FilteringGraphicsContext::setViewports(const uint32_t count, const GraphicsViewport* viewports)
+{
+	if (count == 1) {
+		if (filter(_viewport, ViewportBinding{ viewports[0] })) _inner->setViewports(count, viewports);
+		return;
+	}
+	_viewport.known = false;
+	++_frame.issued;
+	_inner->setViewports(count, viewports);
+}
+
+void FilteringGraphicsContext::setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask)
+{
+	BlendBinding binding = { state, { 1, 1, 1, 1 }, mask };
+	if (factor) memcpy(binding.factor, factor, sizeof(binding.factor));
+	if (filter(_blend, binding)) _inner->setBlendState(state, factor, mask);
+}
+
+void FilteringGraphicsContext::setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef)
+{
+	if (filter(_depth, DepthBinding{ state, stencilRef })) _inner->setDepthStencilState(state, stencilRef);
+}
+
+void FilteringGraphicsContext::setPixelShader(GraphicsPixelShader* shader)
+{
+	//Shaders are otherwise bound through nativeBind, which can't be trusted once the pixel stage changes under it
+	_nativeBinds.clear();
+	++_frame.issued;
+	_inner->setPixelShader(shader);
+}
+
+void FilteringGraphicsContext::finishCommandList(GraphicsCommandList** commands)
+{
+	_inner->finishCommandList(commands);
+	//A deferred context is back to default state once its list is closed
+	invalidate();
+}
+
+bool FilteringGraphicsContext::present(GraphicsSwapChain* swapChain)
+{
+	//Flip model swap chains unbind the back buffer on Present
+	_targets.known = false;
+	return _inner->present(swapChain);
+}
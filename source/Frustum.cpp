@@ -0,0 +1,141 @@
+#include "Frustum.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <intrin.h>
+#include <immintrin.h>
+#include "Utility.h"
+#include "TransformKernels.h"
+
+using namespace DirectX;
+
+namespace {
+	size_t cullScalar(const Frustum& frustum, const BoundingSpheres& spheres, const size_t begin, uint32_t* visible) {
+		size_t count = 0;
+		for (size_t i = begin; i < spheres.size(); ++i) {
+			bool inside = true;
+			for (const auto& p : frustum.planes)
+				inside &= p.x * spheres.x[i] + p.y * spheres.y[i] + p.z * spheres.z[i] + p.w >= -spheres.radius[i];
+			if (inside) visible[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+
+	//Appends the indices of the set bits, lowest first, so the visible list stays sorted.
+	inline size_t appendMask(uint32_t mask, const size_t base, uint32_t* visible) {
+		size_t count = 0;
+		unsigned long bit;
+		while (_BitScanForward(&bit, mask)) {
+			visible[count++] = static_cast<uint32_t>(base + bit);
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+	size_t cullSSE4(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t* visible) {
+		const size_t groups = spheres.size() / 4;
+		size_t count = 0;
+		for (size_t g = 0; g < groups; ++g) {
+			const size_t base = g * 4;
+			const __m128 x = _mm_loadu_ps(&spheres.x[base]);
+			const __m128 y = _mm_loadu_ps(&spheres.y[base]);
+			const __m128 z = _mm_loadu_ps(&spheres.z[base]);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[base]));
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const auto& p : frustum.planes) {
+				__m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(p.x)), _mm_mul_ps(y, _mm_set1_ps(p.y)));
+				d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negRadius));
+			}
+			count += appendMask(static_cast<uint32_t>(_mm_movemask_ps(inside)), base, visible + count);
+		}
+		return count + cullScalar(frustum, spheres, groups * 4, visible + count);
+	}
+
+	size_t cullAVX2(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t* visible) {
+		const size_t groups = spheres.size() / 8;
+		size_t count = 0;
+		for (size_t g = 0; g < groups; ++g) {
+			const size_t base = g * 8;
+			const __m256 x = _mm256_loadu_ps(&spheres.x[base]);
+			const __m256 y = _mm256_loadu_ps(&spheres.y[base]);
+			const __m256 z = _mm256_loadu_ps(&spheres.z[base]);
+			const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[base]));
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const auto& p : frustum.planes) {
+				__m256 d = _mm256_fmadd_ps(x, _mm256_set1_ps(p.x), _mm256_set1_ps(p.w));
+				d = _mm256_fmadd_ps(y, _mm256_set1_ps(p.y), d);
+				d = _mm256_fmadd_ps(z, _mm256_set1_ps(p.z), d);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negRadius, _CMP_GE_OQ));
+			}
+			count += appendMask(static_cast<uint32_t>(_mm256_movemask_ps(inside)), base, visible + count);
+		}
+		return count + cullScalar(frustum, spheres, groups * 8, visible + count);
+	}
+}
+
+Frustum extractFrustum(const XMFLOAT4X4& m)
+{
+	//Gribb/Hartmann on the columns of a row-vector matrix
+	Frustum frustum;
+	const XMVECTOR c0 = XMVectorSet(m._11, m._21, m._31, m._41);
+	const XMVECTOR c1 = XMVectorSet(m._12, m._22, m._32, m._42);
+	const XMVECTOR c2 = XMVectorSet(m._13, m._23, m._33, m._43);
+	const XMVECTOR c3 = XMVectorSet(m._14, m._24, m._34, m._44);
+	const XMVECTOR planes[6] = {
+		XMVectorAdd(c3, c0), XMVectorSubtract(c3, c0),
+		XMVectorAdd(c3, c1), XMVectorSubtract(c3, c1),
+		c2, XMVectorSubtract(c3, c2)
+	};
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+	return frustum;
+}
+
+XMFLOAT4 computeBoundingSphere(const std::vector<Vertex>& vertices)
+{
+	if (vertices.empty()) return XMFLOAT4(0, 0, 0, 0);
+	XMVECTOR min = XMVectorReplicate(FLT_MAX), max = XMVectorReplicate(-FLT_MAX);
+	for (const auto& v : vertices) {
+		const auto p = XMLoadFloat3(&v.Position);
+		min = XMVectorMin(min, p);
+		max = XMVectorMax(max, p);
+	}
+	const auto centre = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+	float radiusSq = 0;
+	for (const auto& v : vertices)
+		radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&v.Position), centre))));
+	XMFLOAT4 sphere;
+	XMStoreFloat4(&sphere, centre);
+	sphere.w = std::sqrt(radiusSq);
+	return sphere;
+}
+
+XMFLOAT4 boundingSphereFromBox(const XMFLOAT3& min, const XMFLOAT3& max)
+{
+	const auto lo = XMLoadFloat3(&min), hi = XMLoadFloat3(&max);
+	XMFLOAT4 sphere;
+	XMStoreFloat4(&sphere, XMVectorScale(XMVectorAdd(lo, hi), 0.5f));
+	sphere.w = 0.5f * XMVectorGetX(XMVector3Length(XMVectorSubtract(hi, lo)));
+	return sphere;
+}
+
+XMFLOAT4 transformBoundingSphere(const XMFLOAT4& local, FXMMATRIX world)
+{
+	XMFLOAT4 sphere;
+	XMStoreFloat4(&sphere, XMVector3Transform(XMVectorSet(local.x, local.y, local.z, 1), world));
+	const float sx = XMVectorGetX(XMVector3LengthSq(world.r[0]));
+	const float sy = XMVectorGetX(XMVector3LengthSq(world.r[1]));
+	const float sz = XMVectorGetX(XMVector3LengthSq(world.r[2]));
+	sphere.w = local.w * std::sqrt(std::max(sx, std::max(sy, sz)));
+	return sphere;
+}
+
+size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, uint32_t* visible)
+{
+	switch (detectSimdLevel()) {
+	case SimdLevel::AVX2: return cullAVX2(frustum, spheres, visible);
+	case SimdLevel::SSE4: return cullSSE4(frustum, spheres, visible);
+	default: return cullScalar(frustum, spheres, 0, visible);
+	}
+}
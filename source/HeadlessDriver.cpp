@@ -0,0 +1,134 @@
+#ifdef HEADLESS_DRIVER
+//Runs a G-buffer and light pass frame on the null device and checks the command stream that
+//reaches the recording backend. Needs no GPU or Windows headers, build it with the other
+//Windows-free sources, e.g.
+//  g++ -std=c++17 -DHEADLESS_DRIVER -Iheaders source/HeadlessDriver.cpp source/NullGraphicsDevice.cpp
+//    source/RecordingGraphicsContext.cpp source/FilteringGraphicsContext.cpp source/RenderGraph.cpp
+//    source/ConstantRing.cpp source/TrackedCBuffer.cpp
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "NullGraphicsDevice.h"
+#include "RecordingGraphicsContext.h"
+#include "FilteringGraphicsContext.h"
+#include "RenderGraph.h"
+#include "ConstantRing.h"
+#include "TrackedCBuffer.h"
+
+namespace {
+	constexpr size_t MESHES = 4;
+	constexpr size_t DRAWS = 64;
+
+	struct FrameConstants {
+		float viewProj[16];
+		float time[4];
+	};
+	struct DrawConstants {
+		float world[16];
+		float mvp[16];
+	};
+
+	int failures = 0;
+
+	void check(const char* what, const size_t actual, const size_t expected) {
+		if (actual == expected) return;
+		printf("[E] %s: %zu, expected %zu\n", what, actual, expected);
+		++failures;
+	}
+
+	size_t countCommands(const RecordingGraphicsContext& recording, const GraphicsCommandType type) {
+		size_t count = 0;
+		for (const auto& command : recording.getCommands())
+			if (command.type == type) ++count;
+		return count;
+	}
+}
+
+int main() {
+	auto device = std::make_shared<NullGraphicsDevice>();
+	auto recording = std::make_shared<RecordingGraphicsContext>();
+	FilteringGraphicsContext gfx(recording);
+
+	TrackedCBuffer<FrameConstants> frameBuffer;
+	ConstantRing ring;
+	if (!frameBuffer.create(*device) || !ring.create(device.get(), 64 * 1024, 3)) {
+		printf("[E] Creating buffers on the null device.\n");
+		return 1;
+	}
+	//Meshes sorted by geometry, so only the first draw of each needs its buffers bound
+	std::vector<GraphicsRef<GraphicsBuffer>> vertices, indices;
+	for (size_t m = 0; m < MESHES; ++m) {
+		vertices.push_back(device->createConstantBuffer(0));
+		indices.push_back(device->createConstantBuffer(0));
+	}
+	GraphicsRef<GraphicsTexture> backBufferTexture;
+	GraphicsRef<GraphicsRenderTarget> backBuffer;
+	GraphicsRef<GraphicsShaderResource> backBufferSRV;
+	device->createRenderTexture(1280, 720, GRAPHICS_FORMAT_R32G32B32A32_FLOAT, false, backBufferTexture, backBuffer, backBufferSRV);
+
+	RenderGraph graph;
+	RGTextureDesc desc;
+	desc.width = 1280;
+	desc.height = 720;
+	const auto albedo = graph.createTexture("albedo", desc);
+	const auto normal = graph.createTexture("normal", desc);
+	const auto lit = graph.createTexture("lit", desc);
+	const auto debug = graph.createTexture("debug", desc);
+	const float clear[4] = { 0, 0, 0, 0 };
+	graph.addPass("geometry").writes(albedo, clear).writes(normal, clear).execute([&] {
+		const uint32_t stride = sizeof(float) * 8, offset = 0;
+		DrawConstants constants = {};
+		for (size_t d = 0; d < DRAWS; ++d) {
+			const size_t mesh = d / (DRAWS / MESHES);
+			auto* vertexBuffer = vertices[mesh].get();
+			gfx.setVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+			gfx.setIndexBuffer(indices[mesh].get(), GRAPHICS_FORMAT_R32_UINT, 0);
+			constants.world[12] = static_cast<float>(d);
+			const auto slice = ring.allocate(&constants, sizeof(constants), gfx);
+			gfx.setVSConstantBuffers1(1, 1, &slice.buffer, &slice.firstConstant, &slice.numConstants);
+			gfx.drawIndexed(36, 0, 0);
+		}
+	});
+	graph.addPass("light").reads(albedo, 0).reads(normal, 1).writes(lit).execute([&] { gfx.draw(4, 0); });
+	//Nothing reads it, so it's culled
+	graph.addPass("debug").reads(normal, 0).writes(debug).execute([&] { gfx.draw(4, 0); });
+	graph.setBackBuffer(backBuffer.get());
+	graph.setOutput(lit);
+	graph.compile(device.get());
+
+	const FrameConstants frameConstants = {};
+	auto runFrame = [&] {
+		gfx.beginFrame();
+		recording->reset();
+		ring.beginFrame(gfx);
+		frameBuffer.update(frameConstants, gfx);
+		gfx.setVSConstantBuffers(0, 1, frameBuffer.getAddress());
+		graph.execute(gfx);
+		gfx.present(nullptr);
+		ring.endFrame(gfx);
+	};
+
+	runFrame();
+	const auto& stats = recording->getStats();
+	check("live passes", graph.getLivePassCount(), 2);
+	check("draws", stats.draws, DRAWS + 1);
+	check("instances", stats.instances, DRAWS + 1);
+	//G-buffer, back buffer, then everything unbound at the end of the graph
+	check("render target switches", stats.renderTargetSwitches, 3);
+	check("vertex buffer binds", countCommands(*recording, GraphicsCommandType::SetVertexBuffers), MESHES);
+	check("index buffer binds", countCommands(*recording, GraphicsCommandType::SetIndexBuffer), MESHES);
+	//The frame constants and one ring slice a draw
+	check("buffer updates", stats.bufferUpdates, DRAWS + 1);
+
+	//Same constants again, the tracked buffer skips its upload and its bind is filtered out
+	runFrame();
+	check("second frame buffer updates", stats.bufferUpdates, DRAWS);
+	check("second frame VS constant buffer binds", countCommands(*recording, GraphicsCommandType::SetVSConstantBuffers), DRAWS);
+	//The frame constants, repeated mesh buffers, and both passes' viewports (all the same size)
+	gfx.beginFrame();
+	check("elided binds", gfx.lastFrame().elided, 1 + 2 * (DRAWS - MESHES) + 2);
+
+	printf(failures ? "[E] Headless frame failed %d checks.\n" : "Headless frame ok.\n", failures);
+	return failures ? 1 : 0;
+}
+#endif
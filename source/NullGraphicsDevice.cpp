@@ -0,0 +1,17 @@
+#include "NullGraphicsDevice.h"
+
+bool NullGraphicsDevice::createStructuredBuffer(const size_t stride, const size_t count, GraphicsRef<GraphicsBuffer>& buffer, GraphicsRef<GraphicsShaderResource>& srv)
+{
+	buffer = placeholder<GraphicsBuffer>();
+	srv = placeholder<GraphicsShaderResource>();
+	return true;
+}
+
+bool NullGraphicsDevice::createRenderTexture(const uint32_t width, const uint32_t height, const GraphicsFormat format, const bool mips,
+	GraphicsRef<GraphicsTexture>& texture, GraphicsRef<GraphicsRenderTarget>& rtv, GraphicsRef<GraphicsShaderResource>& srv)
+{
+	texture = placeholder<GraphicsTexture>();
+	rtv = placeholder<GraphicsRenderTarget>();
+	srv = placeholder<GraphicsShaderResource>();
+	return true;
+}
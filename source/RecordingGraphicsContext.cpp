@@ -0,0 +1,209 @@
+#include "RecordingGraphicsContext.h"
+
+void RecordingGraphicsContext::onNative(const char* label)
+{
+	record(GraphicsCommandType::Native, nullptr, 0, 0, 0, 0, label);
+	++_stats.nativeCalls;
+	if (_inner) _inner->onNative(label);
+}
+
+bool RecordingGraphicsContext::onNativeBind(const char* label, const void* object)
+{
+	record(GraphicsCommandType::Native, object, 0, 0, 0, 0, label);
+	++_stats.nativeCalls;
+	return _inner ? _inner->onNativeBind(label, object) : true;
+}
+
+void RecordingGraphicsContext::clearRenderTarget(GraphicsRenderTarget* rtv, const float colour[4])
+{
+	record(GraphicsCommandType::ClearRenderTarget, rtv);
+	if (_inner) _inner->clearRenderTarget(rtv, colour);
+}
+
+void RecordingGraphicsContext::clearDepthStencil(GraphicsDepthStencil* dsv, const uint32_t flags, const float depth, const uint8_t stencil)
+{
+	record(GraphicsCommandType::ClearDepthStencil, dsv, 0, flags);
+	if (_inner) _inner->clearDepthStencil(dsv, flags, depth, stencil);
+}
+
+void RecordingGraphicsContext::setRenderTargets(const uint32_t count, GraphicsRenderTarget* const* rtvs, GraphicsDepthStencil* dsv)
+{
+	record(GraphicsCommandType::SetRenderTargets, count ? rtvs[0] : nullptr, 0, count);
+	++_stats.renderTargetSwitches;
+	_boundDepthStencil = dsv;
+	if (_inner) _inner->setRenderTargets(count, rtvs, dsv);
+}
+
+GraphicsDepthStencil* RecordingGraphicsContext::getBoundDepthStencil()
+{
+	//Helpers bind through native(), only the inner context knows what they bound
+	return _inner ? _inner->getBoundDepthStencil() : _boundDepthStencil;
+}
+
+void RecordingGraphicsContext::setVSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers)
+{
+	record(GraphicsCommandType::SetVSConstantBuffers, buffers[0], slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setVSConstantBuffers(slot, count, buffers);
+}
+
+void RecordingGraphicsContext::setPSConstantBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers)
+{
+	record(GraphicsCommandType::SetPSConstantBuffers, buffers[0], slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setPSConstantBuffers(slot, count, buffers);
+}
+
+void RecordingGraphicsContext::setVSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	record(GraphicsCommandType::SetVSConstantBuffers, count ? buffers[0] : nullptr, slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setVSConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+}
+
+void RecordingGraphicsContext::setPSConstantBuffers1(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* firstConstant, const uint32_t* numConstants)
+{
+	record(GraphicsCommandType::SetPSConstantBuffers, count ? buffers[0] : nullptr, slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setPSConstantBuffers1(slot, count, buffers, firstConstant, numConstants);
+}
+
+void RecordingGraphicsContext::setVSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs)
+{
+	record(GraphicsCommandType::SetVSShaderResources, srvs[0], slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setVSShaderResources(slot, count, srvs);
+}
+
+void RecordingGraphicsContext::setPSShaderResources(const uint32_t slot, const uint32_t count, GraphicsShaderResource* const* srvs)
+{
+	record(GraphicsCommandType::SetPSShaderResources, srvs[0], slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setPSShaderResources(slot, count, srvs);
+}
+
+void RecordingGraphicsContext::setVertexBuffers(const uint32_t slot, const uint32_t count, GraphicsBuffer* const* buffers, const uint32_t* strides, const uint32_t* offsets)
+{
+	record(GraphicsCommandType::SetVertexBuffers, buffers[0], slot, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setVertexBuffers(slot, count, buffers, strides, offsets);
+}
+
+void RecordingGraphicsContext::setIndexBuffer(GraphicsBuffer* buffer, const GraphicsFormat format, const uint32_t offset)
+{
+	record(GraphicsCommandType::SetIndexBuffer, buffer);
+	++_stats.stateBinds;
+	if (_inner) _inner->setIndexBuffer(buffer, format, offset);
+}
+
+void RecordingGraphicsContext::setRasterizerState(GraphicsRasterizerState* state)
+{
+	record(GraphicsCommandType::SetRasterizerState, state);
+	++_stats.stateBinds;
+	if (_inner) _inner->setRasterizerState(state);
+}
+
+void RecordingGraphicsContext::setViewports(const uint32_t count, const GraphicsViewport* viewports)
+{
+	record(GraphicsCommandType::SetViewports, viewports, 0, count);
+	++_stats.stateBinds;
+	if (_inner) _inner->setViewports(count, viewports);
+}
+
+void RecordingGraphicsContext::setBlendState(GraphicsBlendState* state, const float* factor, const uint32_t mask)
+{
+	record(GraphicsCommandType::SetBlendState, state);
+	++_stats.stateBinds;
+	if (_inner) _inner->setBlendState(state, factor, mask);
+}
+
+void RecordingGraphicsContext::setDepthStencilState(GraphicsDepthState* state, const uint32_t stencilRef)
+{
+	record(GraphicsCommandType::SetDepthStencilState, state);
+	++_stats.stateBinds;
+	if (_inner) _inner->setDepthStencilState(state, stencilRef);
+}
+
+void RecordingGraphicsContext::setPixelShader(GraphicsPixelShader* shader)
+{
+	record(GraphicsCommandType::SetPixelShader, shader);
+	++_stats.stateBinds;
+	if (_inner) _inner->setPixelShader(shader);
+}
+
+void RecordingGraphicsContext::draw(const uint32_t vertexCount, const uint32_t startVertex)
+{
+	record(GraphicsCommandType::Draw, nullptr, startVertex, vertexCount, 1);
+	++_stats.draws;
+	++_stats.instances;
+	if (_inner) _inner->draw(vertexCount, startVertex);
+}
+
+void RecordingGraphicsContext::drawIndexed(const uint32_t indexCount, const uint32_t startIndex, const int32_t baseVertex)
+{
+	record(GraphicsCommandType::DrawIndexed, nullptr, startIndex, indexCount, 1);
+	++_stats.draws;
+	++_stats.instances;
+	if (_inner) _inner->drawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void RecordingGraphicsContext::drawIndexedInstanced(const uint32_t indexCount, const uint32_t instanceCount, const uint32_t startIndex, const int32_t baseVertex, const uint32_t startInstance)
+{
+	record(GraphicsCommandType::DrawIndexedInstanced, nullptr, startIndex, indexCount, instanceCount);
+	++_stats.draws;
+	_stats.instances += instanceCount;
+	if (_inner) _inner->drawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void RecordingGraphicsContext::copyResource(GraphicsResource* destination, GraphicsResource* source)
+{
+	record(GraphicsCommandType::CopyResource, destination);
+	if (_inner) _inner->copyResource(destination, source);
+}
+
+void RecordingGraphicsContext::generateMips(GraphicsShaderResource* srv)
+{
+	record(GraphicsCommandType::GenerateMips, srv);
+	if (_inner) _inner->generateMips(srv);
+}
+
+void RecordingGraphicsContext::updateBuffer(GraphicsBuffer* buffer, const void* data, const size_t size)
+{
+	record(GraphicsCommandType::UpdateBuffer, buffer, 0, 0, 0, size);
+	++_stats.bufferUpdates;
+	_stats.bytesUploaded += size;
+	if (_inner) _inner->updateBuffer(buffer, data, size);
+}
+
+void RecordingGraphicsContext::writeBuffer(GraphicsBuffer* buffer, const size_t offset, const void* data, const size_t size, const bool discard)
+{
+	record(GraphicsCommandType::WriteBuffer, buffer, static_cast<uint32_t>(offset), 0, 0, size);
+	++_stats.bufferUpdates;
+	_stats.bytesUploaded += size;
+	if (_inner) _inner->writeBuffer(buffer, offset, data, size, discard);
+}
+
+void RecordingGraphicsContext::endQuery(GraphicsQuery* query)
+{
+	record(GraphicsCommandType::EndQuery, query);
+	if (_inner) _inner->endQuery(query);
+}
+
+void RecordingGraphicsContext::finishCommandList(GraphicsCommandList** commands)
+{
+	record(GraphicsCommandType::FinishCommandList, nullptr);
+	if (_inner) _inner->finishCommandList(commands);
+}
+
+void RecordingGraphicsContext::executeCommandList(GraphicsCommandList* commands)
+{
+	//The draws inside were recorded by whichever context built the list, not this one
+	record(GraphicsCommandType::ExecuteCommandList, commands);
+	if (_inner) _inner->executeCommandList(commands);
+}
+
+bool RecordingGraphicsContext::present(GraphicsSwapChain* swapChain)
+{
+	record(GraphicsCommandType::Present, swapChain);
+	return _inner && swapChain ? _inner->present(swapChain) : true;
+}
@@ -0,0 +1,290 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::reads(const RGResource resource, const int slot, const uint32_t count)
+{
+	if (slot >= 0 && slot + count > MAX_SLOTS) throw std::runtime_error("[E] Render graph read slot out of range.");
+	_graph._passes[_pass].reads.push_back({ resource, slot, count });
+	_graph._dirty = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::writes(const RGResource resource, const float* clear)
+{
+	Write write = { resource, { 0, 0, 0, 0 }, clear != nullptr };
+	if (clear) memcpy(write.clear, clear, sizeof(write.clear));
+	_graph._passes[_pass].writes.push_back(write);
+	_graph._dirty = true;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::depthStencil(GraphicsDepthStencil* dsv)
+{
+	_graph._passes[_pass].dsv = dsv;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::execute(std::function<void()> fn)
+{
+	_graph._passes[_pass].fn = std::move(fn);
+	return *this;
+}
+
+RenderGraph::RenderGraph()
+{
+	std::fill(std::begin(_boundSRVs), std::end(_boundSRVs), NONE);
+}
+
+RGResource RenderGraph::createTexture(const char* name, const RGTextureDesc& desc)
+{
+	_resources.push_back({ name, desc, false });
+	_dirty = true;
+	return static_cast<RGResource>(_resources.size() - 1);
+}
+
+RGResource RenderGraph::importResource(const char* name)
+{
+	_resources.push_back({ name, RGTextureDesc(), true, static_cast<uint32_t>(_targets.size()) });
+	_targets.emplace_back();
+	_dirty = true;
+	return static_cast<RGResource>(_resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const char* name)
+{
+	_passes.push_back({ name });
+	_dirty = true;
+	return PassBuilder(*this, _passes.size() - 1);
+}
+
+void RenderGraph::setBackBuffer(GraphicsRenderTarget* rtv)
+{
+	if (_backBuffer == NONE) {
+		_backBuffer = static_cast<uint32_t>(_targets.size());
+		_targets.emplace_back();
+	}
+	//Owned by the swap chain's user, not the graph
+	_targets[_backBuffer].rtv = GraphicsRef<GraphicsRenderTarget>(rtv, [](GraphicsRenderTarget*) {});
+}
+
+void RenderGraph::setOutput(const RGResource resource)
+{
+	if (resource == _output) return;
+	_output = resource;
+	_dirty = true;
+}
+
+void RenderGraph::compile(GraphicsDevice* device)
+{
+	if (_output == NONE || _output >= _resources.size()) throw std::runtime_error("[E] Render graph has no output.");
+	if (_resources[_output].imported) throw std::runtime_error("[E] Render graph output must be a graph texture.");
+	if (_backBuffer == NONE) throw std::runtime_error("[E] Render graph has no back buffer. Try calling 'setBackBuffer'");
+
+	//Walk back from the output, a pass lives if something downstream needs what it writes
+	std::vector<bool> needed(_resources.size(), false);
+	needed[_output] = true;
+	for (size_t p = _passes.size(); p-- > 0;) {
+		auto& pass = _passes[p];
+		pass.live = false;
+		for (const auto& write : pass.writes)
+			if (needed[write.resource]) pass.live = true;
+		if (!pass.live) continue;
+		for (const auto& read : pass.reads) {
+			for (const auto& write : pass.writes)
+				if (write.resource == read.resource) throw std::runtime_error("[E] Render graph pass reads and writes the same resource.");
+			needed[read.resource] = true;
+		}
+	}
+	_order.clear();
+	for (size_t p = 0; p < _passes.size(); ++p)
+		if (_passes[p].live) _order.push_back(p);
+
+	//Lifetimes of the transients, in positions along the live order
+	std::vector<size_t> first(_resources.size(), SIZE_MAX), last(_resources.size(), 0);
+	for (size_t i = 0; i < _order.size(); ++i) {
+		const auto& pass = _passes[_order[i]];
+		for (const auto& write : pass.writes) {
+			first[write.resource] = std::min(first[write.resource], i);
+			last[write.resource] = std::max(last[write.resource], i);
+		}
+		for (const auto& read : pass.reads) {
+			if (first[read.resource] == SIZE_MAX && !_resources[read.resource].imported)
+				throw std::runtime_error("[E] Render graph pass reads a texture before anything writes it.");
+			last[read.resource] = std::max(last[read.resource], i);
+		}
+	}
+
+	//Transients whose lifetimes don't overlap share a pooled target, the output is the back buffer
+	std::vector<RGResource> transients;
+	for (RGResource r = 0; r < _resources.size(); ++r) {
+		if (_resources[r].imported) continue;
+		_resources[r].target = NONE;
+		if (r == _output) _resources[r].target = _backBuffer;
+		else if (first[r] != SIZE_MAX) transients.push_back(r);
+	}
+	std::sort(transients.begin(), transients.end(), [&](const RGResource a, const RGResource b) { return first[a] < first[b]; });
+	for (auto& target : _targets) target.inUse = false;
+	for (const auto r : transients) {
+		const auto& desc = _resources[r].desc;
+		uint32_t chosen = NONE, empty = NONE;
+		for (uint32_t t = 0; t < _targets.size() && chosen == NONE; ++t) {
+			const auto& target = _targets[t];
+			if (!target.pooled) continue;
+			//Shared with a transient that's finished by the time this one starts
+			if (target.inUse) { if (target.desc == desc && target.freeAfter < first[r]) chosen = t; }
+			//Kept from the last compile
+			else if (target.texture && target.desc == desc) chosen = t;
+			else if (empty == NONE) empty = t;
+		}
+		if (chosen == NONE) {
+			chosen = empty;
+			if (chosen == NONE) {
+				chosen = static_cast<uint32_t>(_targets.size());
+				_targets.emplace_back();
+			}
+			auto& target = _targets[chosen];
+			target.pooled = true;
+			target.desc = desc;
+			createTarget(device, target);
+		}
+		_targets[chosen].inUse = true;
+		_targets[chosen].freeAfter = last[r];
+		_resources[r].target = chosen;
+	}
+	//Nothing this compile needs them, let them go
+	for (auto& target : _targets) {
+		if (!target.pooled || target.inUse) continue;
+		target.srv.reset();
+		target.rtv.reset();
+		target.texture.reset();
+	}
+	_transientCount = transients.size();
+	_dirty = false;
+}
+
+void RenderGraph::execute(GraphicsContext& gfx)
+{
+	if (_dirty) throw std::runtime_error("[E] Render graph changed since it was compiled. Try calling 'compile'");
+	for (auto& resource : _resources) resource.written = false;
+
+	for (const auto p : _order) {
+		const auto& pass = _passes[p];
+
+		//Outputs: nothing may still be reading them, then bind the ones the graph owns
+		GraphicsRenderTarget* rtvs[MAX_TARGETS];
+		uint32_t rtvCount = 0;
+		GraphicsViewport viewport = {};
+		for (const auto& write : pass.writes) {
+			const auto t = _resources[write.resource].target;
+			unbindSlots(gfx, t);
+			if (!_targets[t].rtv || rtvCount >= MAX_TARGETS) continue;
+			//Transients can be smaller than the screen, the pass draws to the whole of its first target
+			if (rtvCount == 0) {
+				viewport.width = static_cast<float>(_resources[write.resource].desc.width);
+				viewport.height = static_cast<float>(_resources[write.resource].desc.height);
+				viewport.maxDepth = 1.0f;
+			}
+			rtvs[rtvCount++] = _targets[t].rtv.get();
+		}
+		if (rtvCount > 0) {
+			gfx.setRenderTargets(rtvCount, rtvs, pass.dsv);
+			if (viewport.width > 0 && viewport.height > 0) gfx.setViewports(1, &viewport);
+			trackRenderTargets(pass);
+		}
+		for (const auto& write : pass.writes) {
+			auto& resource = _resources[write.resource];
+			auto& target = _targets[resource.target];
+			//Per resource, a target shared with an earlier transient still needs clearing
+			if (write.hasClear && !resource.written && target.rtv) gfx.clearRenderTarget(target.rtv.get(), write.clear);
+			resource.written = true;
+			target.mipsDirty = target.desc.mips;
+		}
+
+		//Inputs: still bound as an output means an earlier pass' targets have to come off first
+		for (const auto& read : pass.reads) {
+			const auto t = _resources[read.resource].target;
+			if (std::find(_boundRTs, _boundRTs + _boundRTCount, t) != _boundRTs + _boundRTCount) {
+				gfx.setRenderTargets(0, nullptr, nullptr);
+				_boundRTCount = 0;
+			}
+			if (read.slot < 0) continue;
+			auto& target = _targets[t];
+			if (target.mipsDirty && target.srv) {
+				gfx.generateMips(target.srv.get());
+				target.mipsDirty = false;
+			}
+			bindSlots(gfx, read.slot, read.count, t, target.srv.get());
+		}
+
+		if (pass.fn) pass.fn();
+		//Imported outputs are bound by the pass itself
+		if (rtvCount == 0) trackRenderTargets(pass);
+	}
+
+	//Leave nothing bound, next frame starts by writing these again
+	GraphicsShaderResource* nullSRVs[MAX_SLOTS] = {};
+	uint32_t used = 0;
+	for (uint32_t s = 0; s < MAX_SLOTS; ++s)
+		if (_boundSRVs[s] != NONE) used = s + 1;
+	if (used > 0) gfx.setPSShaderResources(0, used, nullSRVs);
+	std::fill(std::begin(_boundSRVs), std::end(_boundSRVs), NONE);
+	gfx.setRenderTargets(0, nullptr, nullptr);
+	_boundRTCount = 0;
+}
+
+GraphicsRenderTarget* RenderGraph::getRenderTarget(const RGResource resource) const
+{
+	const auto t = _resources[resource].target;
+	return t == NONE ? nullptr : _targets[t].rtv.get();
+}
+
+const bool RenderGraph::isPassLive(const char* name) const
+{
+	for (const auto& pass : _passes)
+		if (pass.name == name) return pass.live;
+	return false;
+}
+
+const size_t RenderGraph::getPooledTargetCount() const
+{
+	size_t count = 0;
+	for (const auto& target : _targets)
+		if (target.pooled && target.inUse) ++count;
+	return count;
+}
+
+void RenderGraph::createTarget(GraphicsDevice* device, Target& target)
+{
+	target.srv.reset();
+	target.rtv.reset();
+	target.texture.reset();
+	if (!device) return;
+	if (!device->createRenderTexture(target.desc.width, target.desc.height, target.desc.format, target.desc.mips, target.texture, target.rtv, target.srv))
+		throw std::runtime_error("[E] Creating render graph texture.");
+}
+
+void RenderGraph::unbindSlots(GraphicsContext& gfx, const uint32_t target)
+{
+	GraphicsShaderResource* nullSRV = nullptr;
+	for (uint32_t s = 0; s < MAX_SLOTS; ++s) {
+		if (_boundSRVs[s] != target) continue;
+		gfx.setPSShaderResources(s, 1, &nullSRV);
+		_boundSRVs[s] = NONE;
+	}
+}
+
+void RenderGraph::trackRenderTargets(const Pass& pass)
+{
+	_boundRTCount = 0;
+	for (const auto& write : pass.writes)
+		if (_boundRTCount < MAX_TARGETS) _boundRTs[_boundRTCount++] = _resources[write.resource].target;
+}
+
+void RenderGraph::bindSlots(GraphicsContext& gfx, const uint32_t slot, const uint32_t count, const uint32_t target, GraphicsShaderResource* srv)
+{
+	for (uint32_t s = slot; s < slot + count; ++s) _boundSRVs[s] = target;
+	//Imported resources are bound by their pass, only their occupancy is tracked
+	if (srv) gfx.setPSShaderResources(slot, 1, &srv);
+}
@@ -0,0 +1,78 @@
+#include "SceneArena.h"
+#include "AllocationCounter.h"
+
+void* BlockPool::bump(const size_t slabSize)
+{
+	if (_blockSize > _remaining) {
+		//new[] only promises max_align_t, over-allocate and align the start by hand
+		_slabs.push_back(std::make_unique<uint8_t[]>(slabSize + SceneArena::BLOCK_ALIGN - 1));
+		const auto start = reinterpret_cast<uintptr_t>(_slabs.back().get());
+		_cursor = reinterpret_cast<uint8_t*>((start + SceneArena::BLOCK_ALIGN - 1) & ~(SceneArena::BLOCK_ALIGN - 1));
+		_remaining = slabSize;
+	}
+	void* block = _cursor;
+	_cursor += _blockSize;
+	_remaining -= _blockSize;
+	return block;
+}
+
+BlockPool& SceneArena::poolFor(const PoolTag tag, const size_t size)
+{
+	const size_t blockSize = (size + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+	for (auto& pool : _pools)
+		if (pool._tag == tag && pool.getBlockSize() == blockSize) return pool;
+	_pools.emplace_back(tag, blockSize);
+	return _pools.back();
+}
+
+void* SceneArena::allocate(const PoolTag tag, const size_t size)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	auto& pool = poolFor(tag, size);
+	++pool._live;
+	if (pool._free) {
+		auto* block = pool._free;
+		pool._free = block->next;
+		AllocationCounter::onPoolAllocation(true);
+		return block;
+	}
+	AllocationCounter::onPoolAllocation(false);
+	//Slabs hold a whole number of blocks; objects bigger than a slab get one of their own
+	const size_t blockSize = pool.getBlockSize();
+	const size_t slabSize = blockSize > SLAB_SIZE ? blockSize : SLAB_SIZE - SLAB_SIZE % blockSize;
+	return pool.bump(slabSize);
+}
+
+void SceneArena::deallocate(const PoolTag tag, void* block, const size_t size)
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	auto& pool = poolFor(tag, size);
+	--pool._live;
+	auto* freed = static_cast<BlockPool::FreeBlock*>(block);
+	freed->next = pool._free;
+	pool._free = freed;
+}
+
+void SceneArena::reset()
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	_pools.clear();
+}
+
+const size_t SceneArena::getLiveBlocks()
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	size_t live = 0;
+	for (const auto& pool : _pools)
+		live += pool.getLive();
+	return live;
+}
+
+const size_t SceneArena::getChunkCount()
+{
+	std::lock_guard<std::mutex> guard(_lock);
+	size_t chunks = 0;
+	for (const auto& pool : _pools)
+		chunks += pool.getSlabCount();
+	return chunks;
+}
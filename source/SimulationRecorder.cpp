@@ -0,0 +1,207 @@
+#include "SimulationRecorder.h"
+#include "Entity.h"
+#include "EntityRegistry.h"
+
+namespace {
+	void writeVarint(std::vector<uint8_t>& out, size_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	size_t readVarint(const uint8_t*& cursor) {
+		size_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			const uint8_t byte = *cursor++;
+			value |= static_cast<size_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0) return value;
+		}
+	}
+}
+
+SimulationRecorder::SimulationRecorder(const size_t ringBytes, const size_t maxRecords, const uint32_t captureInterval)
+	: _ring(ringBytes), _records(maxRecords), _firstRecord(0), _recordCount(0), _writeOffset(0),
+	_capturesSinceKey(0), _frame(0), _captureInterval(captureInterval > 0 ? captureInterval : 1),
+	_unsavedSystems(0), _unsavedComponents(0)
+{
+}
+
+//Layout: [entity count] then per entity [handle][byte size][per component: index, byte size, state],
+//followed by [system count] and a sized block per system.
+void SimulationRecorder::serialize(std::vector<uint8_t>& out)
+{
+	out.clear();
+	_unsavedSystems = 0;
+	_unsavedComponents = 0;
+	StateWriter writer(out);
+	const auto& registry = EntityRegistry::getInstance();
+	writer.write(static_cast<uint32_t>(registry.size()));
+	for (const auto handle : registry.getHandles()) {
+		const auto* e = registry.get(handle);
+		writer.write(handle.value);
+		const size_t entitySizeAt = writer.size();
+		writer.write(static_cast<uint32_t>(0));
+		for (size_t i = 0; i < COMPONENT_TYPE_COUNT; ++i) {
+			const auto* component = e->getComponentAt(i);
+			if (!component) continue;
+			writer.write(static_cast<uint8_t>(i));
+			const size_t componentSizeAt = writer.size();
+			writer.write(static_cast<uint32_t>(0));
+			component->saveState(writer);
+			const size_t componentSize = writer.size() - componentSizeAt - sizeof(uint32_t);
+			if (componentSize == 0 && (component->getType() & SIMULATION_OWNED)) ++_unsavedComponents;
+			writer.patch(componentSizeAt, static_cast<uint32_t>(componentSize));
+		}
+		writer.patch(entitySizeAt, static_cast<uint32_t>(writer.size() - entitySizeAt - sizeof(uint32_t)));
+	}
+	writer.write(static_cast<uint32_t>(_systems.size()));
+	for (const auto& system : _systems) {
+		const size_t systemSizeAt = writer.size();
+		writer.write(static_cast<uint32_t>(0));
+		system->saveState(writer);
+		const size_t systemSize = writer.size() - systemSizeAt - sizeof(uint32_t);
+		if (systemSize == 0) ++_unsavedSystems;
+		writer.patch(systemSizeAt, static_cast<uint32_t>(systemSize));
+	}
+}
+
+//Entities that no longer exist, or have since lost a component, are skipped.
+void SimulationRecorder::deserialize(const std::vector<uint8_t>& in)
+{
+	const auto& registry = EntityRegistry::getInstance();
+	StateReader reader(in.data(), in.size());
+	uint32_t entityCount = 0, size = 0;
+	reader.read(entityCount);
+	for (uint32_t n = 0; n < entityCount; ++n) {
+		EntityHandle handle;
+		reader.read(handle.value);
+		reader.read(size);
+		auto entityReader = reader.sub(size);
+		auto* e = registry.get(handle);
+		if (!e) continue;
+		uint8_t index = 0;
+		while (entityReader.read(index) && entityReader.read(size)) {
+			auto componentReader = entityReader.sub(size);
+			if (index >= COMPONENT_TYPE_COUNT) continue;
+			if (auto* component = e->getComponentAt(index))
+				component->loadState(componentReader);
+		}
+	}
+	uint32_t systemCount = 0;
+	reader.read(systemCount);
+	for (uint32_t i = 0; i < systemCount && i < _systems.size(); ++i) {
+		reader.read(size);
+		auto systemReader = reader.sub(size);
+		_systems[i]->loadState(systemReader);
+	}
+}
+
+//XOR against the previous state then store [zero run][literal length][literal bytes] groups.
+void SimulationRecorder::encode(const std::vector<uint8_t>& current, const std::vector<uint8_t>& previous)
+{
+	_encoded.clear();
+	const size_t size = current.size();
+	auto delta = [&](const size_t i) { return static_cast<uint8_t>(current[i] ^ (i < previous.size() ? previous[i] : 0)); };
+	size_t i = 0;
+	while (i < size) {
+		size_t zeros = 0;
+		while (i + zeros < size && delta(i + zeros) == 0) ++zeros;
+		i += zeros;
+		size_t literals = 0;
+		while (i + literals < size && delta(i + literals) != 0) ++literals;
+		writeVarint(_encoded, zeros);
+		writeVarint(_encoded, literals);
+		for (size_t j = 0; j < literals; ++j)
+			_encoded.push_back(delta(i + j));
+		i += literals;
+	}
+}
+
+void SimulationRecorder::decode(const Record& record, std::vector<uint8_t>& state) const
+{
+	if (record.keyframe) state.assign(record.rawSize, 0);
+	else state.resize(record.rawSize, 0);
+	const uint8_t* cursor = _ring.data() + record.offset;
+	const uint8_t* end = cursor + record.encodedSize;
+	size_t i = 0;
+	while (cursor < end) {
+		i += readVarint(cursor);
+		const size_t literals = readVarint(cursor);
+		for (size_t j = 0; j < literals; ++j)
+			state[i++] ^= *cursor++;
+	}
+}
+
+void SimulationRecorder::dropOldest()
+{
+	_firstRecord = (_firstRecord + 1) % _records.size();
+	--_recordCount;
+	//A delta without its keyframe can't be rebuilt, so drop up to the next keyframe
+	while (_recordCount && !record(0).keyframe) {
+		_firstRecord = (_firstRecord + 1) % _records.size();
+		--_recordCount;
+	}
+}
+
+void SimulationRecorder::evictOverlapping(const size_t begin, const size_t end)
+{
+	while (_recordCount) {
+		const auto& oldest = record(0);
+		if (oldest.offset >= end || oldest.offset + oldest.encodedSize <= begin) break;
+		dropOldest();
+	}
+}
+
+void SimulationRecorder::onFrame()
+{
+	if (++_frame % _captureInterval != 0) return;
+
+	serialize(_current);
+	bool keyframe = _recordCount == 0 || _capturesSinceKey >= KEYFRAME_INTERVAL;
+	encode(_current, keyframe ? std::vector<uint8_t>() : _previous);
+	if (_encoded.size() > _ring.size()) return;
+
+	if (_writeOffset + _encoded.size() > _ring.size()) _writeOffset = 0;
+	evictOverlapping(_writeOffset, _writeOffset + _encoded.size());
+	if (_recordCount == _records.size()) dropOldest();
+	if (_recordCount == 0 && !keyframe) {
+		//Eviction took our delta base with it
+		keyframe = true;
+		encode(_current, std::vector<uint8_t>());
+		//A keyframe is bigger than the delta that fitted, it may not fit the ring at all
+		if (_encoded.size() > _ring.size()) return;
+		if (_writeOffset + _encoded.size() > _ring.size()) _writeOffset = 0;
+	}
+
+	std::memcpy(_ring.data() + _writeOffset, _encoded.data(), _encoded.size());
+	auto& slot = _records[(_firstRecord + _recordCount) % _records.size()];
+	slot = { _frame, _writeOffset, _encoded.size(), _current.size(), keyframe };
+	++_recordCount;
+	_writeOffset += _encoded.size();
+	_capturesSinceKey = keyframe ? 1 : _capturesSinceKey + 1;
+	_previous.swap(_current);
+}
+
+//Restores the newest retained snapshot at or before frame. Later snapshots belong to
+//the discarded future and are dropped, recording carries on from the restored frame.
+bool SimulationRecorder::restore(const uint64_t frame)
+{
+	if (_recordCount == 0 || frame < record(0).frame) return false;
+	size_t target = _recordCount - 1;
+	while (record(target).frame > frame) --target;
+	size_t key = target;
+	while (!record(key).keyframe) --key;
+
+	for (size_t i = key; i <= target; ++i)
+		decode(record(i), _previous);
+	deserialize(_previous);
+
+	const auto& restored = record(target);
+	_frame = restored.frame;
+	_writeOffset = restored.offset + restored.encodedSize;
+	_capturesSinceKey = target - key + 1;
+	_recordCount = target + 1;
+	return true;
+}
@@ -0,0 +1,60 @@
+#include "SystemScheduler.h"
+
+SystemScheduler::SystemScheduler() : _dirty(false)
+{
+}
+
+void SystemScheduler::add(const std::shared_ptr<ASystem> system)
+{
+	auto node = std::make_unique<Node>();
+	node->system = system;
+	_nodes.push_back(std::move(node));
+	_dirty = true;
+}
+
+void SystemScheduler::build()
+{
+	for (auto& node : _nodes) {
+		node->dependents.clear();
+		node->dependencyCount = 0;
+	}
+	for (size_t i = 0; i < _nodes.size(); ++i) {
+		for (size_t j = i + 1; j < _nodes.size(); ++j) {
+			if (!_nodes[i]->system->conflictsWith(*_nodes[j]->system)) continue;
+			_nodes[i]->dependents.push_back(j);
+			++_nodes[j]->dependencyCount;
+		}
+	}
+	_dirty = false;
+}
+
+void SystemScheduler::runNode(Node& node, std::atomic<size_t>& pending)
+{
+	auto& pool = ThreadPool::getInstance();
+	auto& system = *node.system;
+	if (system.getSplit() > 0)
+		pool.parallelFor(system.getEntityCount(), system.getSplit(), [&system](size_t begin, size_t end) { system.onActionRange(begin, end); });
+	else
+		system.onAction();
+
+	for (const auto dependent : node.dependents) {
+		auto& next = *_nodes[dependent];
+		if (--next.remaining == 0)
+			pool.submit([this, &next, &pending] { runNode(next, pending); });
+	}
+	--pending;
+}
+
+void SystemScheduler::run()
+{
+	if (_nodes.empty()) return;
+	if (_dirty) build();
+	auto& pool = ThreadPool::getInstance();
+	std::atomic<size_t> pending(_nodes.size());
+	for (auto& node : _nodes)
+		node->remaining = node->dependencyCount;
+	for (auto& node : _nodes)
+		if (node->dependencyCount == 0)
+			pool.submit([this, n = node.get(), &pending] { runNode(*n, pending); });
+	pool.wait(pending);
+}
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+thread_local int ThreadPool::_workerIndex = -1;
+
+ThreadPool::ThreadPool(const size_t workerCount) : _queued(0), _nextQueue(0), _running(true)
+{
+	for (size_t i = 0; i < workerCount; ++i)
+		_queues.push_back(std::make_unique<WorkQueue>());
+	for (size_t i = 0; i < workerCount; ++i)
+		_workers.emplace_back(&ThreadPool::workerLoop, this, static_cast<int>(i));
+}
+
+void ThreadPool::WorkQueue::pushBack(Task&& task)
+{
+	if (count == tasks.size()) {
+		std::vector<Task> grown(tasks.size() * 2);
+		for (size_t i = 0; i < count; ++i)
+			grown[i] = std::move(tasks[(head + i) % tasks.size()]);
+		tasks.swap(grown);
+		head = 0;
+	}
+	tasks[(head + count) % tasks.size()] = std::move(task);
+	++count;
+}
+
+bool ThreadPool::WorkQueue::popBack(Task& out)
+{
+	if (count == 0) return false;
+	--count;
+	out = std::move(tasks[(head + count) % tasks.size()]);
+	return true;
+}
+
+bool ThreadPool::WorkQueue::popFront(Task& out)
+{
+	if (count == 0) return false;
+	out = std::move(tasks[head]);
+	head = (head + 1) % tasks.size();
+	--count;
+	return true;
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(_sleepLock);
+		_running = false;
+	}
+	_wake.notify_all();
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+	//Workers keep spawned work local, anyone else spreads it round robin
+	const size_t queue = _workerIndex >= 0 ? _workerIndex : _nextQueue++ % _queues.size();
+	{
+		//Count before publishing so a thief can never decrement past zero
+		std::lock_guard<std::mutex> guard(_sleepLock);
+		++_queued;
+	}
+	{
+		std::lock_guard<std::mutex> guard(_queues[queue]->lock);
+		_queues[queue]->pushBack(std::move(task));
+	}
+	_wake.notify_one();
+}
+
+bool ThreadPool::pop(const size_t queue, Task& out)
+{
+	std::lock_guard<std::mutex> guard(_queues[queue]->lock);
+	return _queues[queue]->popBack(out);
+}
+
+bool ThreadPool::steal(const size_t thief, Task& out)
+{
+	for (size_t i = 1; i <= _queues.size(); ++i) {
+		const size_t victim = (thief + i) % _queues.size();
+		std::lock_guard<std::mutex> guard(_queues[victim]->lock);
+		if (_queues[victim]->popFront(out)) return true;
+	}
+	return false;
+}
+
+bool ThreadPool::runPending()
+{
+	Task task;
+	const size_t home = _workerIndex >= 0 ? _workerIndex : 0;
+	if (!pop(home, task) && !steal(home, task))
+		return false;
+	--_queued;
+	task();
+	return true;
+}
+
+void ThreadPool::workerLoop(const int index)
+{
+	_workerIndex = index;
+	while (true) {
+		if (runPending()) continue;
+		std::unique_lock<std::mutex> guard(_sleepLock);
+		_wake.wait(guard, [this] { return _queued > 0 || !_running; });
+		if (!_running) return;
+	}
+}
+
+void ThreadPool::wait(const std::atomic<size_t>& counter)
+{
+	while (counter > 0)
+		if (!runPending()) std::this_thread::yield();
+}
+
+void ThreadPool::parallelFor(const size_t count, const size_t grain, FunctionRef<void(size_t, size_t)> fn)
+{
+	if (count == 0) return;
+	const size_t chunk = grain > 0 ? grain : count;
+	std::atomic<size_t> remaining((count + chunk - 1) / chunk);
+	//Keep the first chunk for ourselves, no point queueing work we are about to wait on
+	for (size_t begin = chunk; begin < count; begin += chunk) {
+		const size_t end = std::min(begin + chunk, count);
+		submit([fn, &remaining, begin, end] { fn(begin, end); --remaining; });
+	}
+	fn(0, std::min(chunk, count));
+	--remaining;
+	wait(remaining);
+}
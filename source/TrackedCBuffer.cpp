@@ -0,0 +1,15 @@
+#include "TrackedCBuffer.h"
+
+std::atomic<size_t> CBufferCounter::_uploads = 0;
+std::atomic<size_t> CBufferCounter::_skipped = 0;
+CBufferStats CBufferCounter::_lastFrame;
+CBufferStats CBufferCounter::_frameStart;
+
+void CBufferCounter::beginFrame()
+{
+	const size_t uploads = _uploads, skipped = _skipped;
+	_lastFrame.uploads = uploads - _frameStart.uploads;
+	_lastFrame.skipped = skipped - _frameStart.skipped;
+	_frameStart.uploads = uploads;
+	_frameStart.skipped = skipped;
+}
@@ -1,16 +1,22 @@
 #include "TransformComponent.h"
+#include <cmath>
 
 TransformComponent::TransformComponent() : AComponent(COMPONENT_TRANSFORM), _position(XMFLOAT3(0,0,0)), _scale(XMFLOAT3(0,0,0)),
-	_orientation(XMFLOAT3(0,0,0))
+	_orientation(XMFLOAT4(0,0,0,1)), _oOrientation(XMFLOAT4(0,0,0,1))
 {
 }
 
 TransformComponent::TransformComponent(XMFLOAT3 p , XMFLOAT3 o, XMFLOAT3 s, std::shared_ptr<TransformComponent> parent)
-	: AComponent(COMPONENT_TRANSFORM), _position(p), _oPosition(p), _scale(s), _oScale(s), _orientation(o), _oOrientation(o), _parent(parent)
+	: AComponent(COMPONENT_TRANSFORM), _position(p), _oPosition(p), _scale(s), _oScale(s), _orientation(eulerToQuaternion(o)), _oOrientation(_orientation), _parent(parent)
 {
 	getTransform();
 }
 
+TransformComponent::~TransformComponent()
+{
+	TransformHierarchy::getInstance().remove(this);
+}
+
 TransformComponent::TransformComponent(const TransformComponent& tc) : AComponent(COMPONENT_TRANSFORM)
 {
 	deepCopy(tc);
@@ -40,29 +46,53 @@ const XMFLOAT3X3& TransformComponent::getTransform() {
 	return _transform;
 }
 
+const XMFLOAT3 TransformComponent::getPosition() const {
+	if (!_parent || _hierarchyIndex < 0) return _position;
+	const auto& world = TransformHierarchy::getInstance().getWorld(_hierarchyIndex);
+	return XMFLOAT3(world._41, world._42, world._43);
+}
+
+const XMFLOAT3 TransformComponent::getScale() const {
+	if (!_parent || _hierarchyIndex < 0) return _scale;
+	//Row lengths of the world matrix, exact unless a parent scales non-uniformly under a rotation
+	const auto& world = TransformHierarchy::getInstance().getWorld(_hierarchyIndex);
+	return XMFLOAT3(std::sqrt(world._11 * world._11 + world._12 * world._12 + world._13 * world._13),
+		std::sqrt(world._21 * world._21 + world._22 * world._22 + world._23 * world._23),
+		std::sqrt(world._31 * world._31 + world._32 * world._32 + world._33 * world._33));
+}
+
 const XMMATRIX TransformComponent::getTransformAligned() const {
-	auto rot = _orientation;
-	auto rotX = XMMatrixRotationX(rot.x);
-	auto rotY = XMMatrixRotationY(rot.y);
-	auto rotZ = XMMatrixRotationZ(rot.z);
-	auto rotMat = rotX * rotY * rotZ;
-	auto scale = getScale();
-	auto scaleMat = XMMatrixScaling(scale.x, scale.y, scale.z);
-	auto translateMat = XMMatrixTranslation(_position.x, _position.y, _position.z);
-	auto parentMat = XMMatrixIdentity();
-	if (_parent) {
-		auto parentRot = _parent->getOrientation();
-		auto parentPos = _parent->getPosition();
-		auto subMatTrans = XMMatrixTranslationFromVector(XMVectorSubtract(XMLoadFloat3(&_position), XMLoadFloat3(&parentPos)));
-		auto posMatTrans = XMMatrixTranslationFromVector(XMVectorAdd(XMLoadFloat3(&_position), XMLoadFloat3(&parentPos)));
-		auto pRotX = XMMatrixRotationX(parentRot.x);
-		auto pRotY = XMMatrixRotationY(parentRot.y);
-		auto pRotZ = XMMatrixRotationZ(parentRot.z);
-		auto pRotMat = pRotX * pRotY * pRotZ;
-		return translateMat * pRotMat * scaleMat * XMMatrixTranslationFromVector(XMLoadFloat3(&parentPos));
+	if (_hierarchyIndex < 0) return getLocalAligned();
+	return XMLoadFloat4x4(&TransformHierarchy::getInstance().getWorld(_hierarchyIndex));
+}
+
+const XMMATRIX TransformComponent::getLocalAligned() const {
+	if (_cachedVersion != _version) {
+		auto rotMat = XMMatrixRotationQuaternion(XMLoadFloat4(&_orientation));
+		auto scaleMat = XMMatrixScaling(_scale.x, _scale.y, _scale.z);
+		auto translateMat = XMMatrixTranslation(_position.x, _position.y, _position.z);
+		XMStoreFloat4x4(&_localCache, rotMat * scaleMat * translateMat);
+		_cachedVersion = _version;
 	}
+	return XMLoadFloat4x4(&_localCache);
+}
+
+const XMFLOAT4 TransformComponent::getOrientation() const {
+	if (!_parent) return _orientation;
+	auto parentOrientation = _parent->getOrientation();
+	XMFLOAT4 world;
+	XMStoreFloat4(&world, XMQuaternionMultiply(XMLoadFloat4(&_orientation), XMLoadFloat4(&parentOrientation)));
+	return world;
+}
 
-	return rotMat * scaleMat * translateMat;
+//Matches the old Euler convention of rotating about X, then Y, then Z.
+XMFLOAT4 TransformComponent::eulerToQuaternion(const XMFLOAT3& euler) {
+	auto qx = XMQuaternionRotationNormal(XMVectorSet(1, 0, 0, 0), euler.x);
+	auto qy = XMQuaternionRotationNormal(XMVectorSet(0, 1, 0, 0), euler.y);
+	auto qz = XMQuaternionRotationNormal(XMVectorSet(0, 0, 1, 0), euler.z);
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, XMQuaternionMultiply(XMQuaternionMultiply(qx, qy), qz));
+	return q;
 }
 
 void TransformComponent::onPropertyChanged(const AComponent& component)
@@ -82,17 +112,24 @@ void TransformComponent::resetTransform()
 	_position = _oPosition;
 	_orientation = _oOrientation;
 	_scale = _oScale;
+	markDirty();
 	notify();
 }
 
 void TransformComponent::rotatePosition(const XMFLOAT3& axis, const float angle) {
 	auto rotMat = XMMatrixRotationAxis(XMLoadFloat3(&axis), angle);
 	XMStoreFloat3(&_position, XMVector3Transform(XMLoadFloat3(&_position), rotMat));
+	markDirty();
 }
 
-void TransformComponent::rotate(const XMFLOAT3& axis, const float angle, const XMFLOAT3 origin)
+void TransformComponent::rotate(const XMFLOAT3& axis, const float angle, const XMFLOAT3 point)
 {
-	XMStoreFloat3(&_orientation,XMVectorAdd(XMLoadFloat3(&_orientation), XMVectorScale(XMLoadFloat3(&axis), angle)));
+	auto axisV = XMLoadFloat3(&axis);
+	if (XMVector3Equal(axisV, XMVectorZero())) return;
+	//Local-space rotation: applied before the current orientation
+	auto delta = XMQuaternionRotationNormal(XMVector3Normalize(axisV), angle);
+	XMStoreFloat4(&_orientation, XMQuaternionNormalize(XMQuaternionMultiply(delta, XMLoadFloat4(&_orientation))));
+	markDirty();
 }
 
 void TransformComponent::move(const XMFLOAT3& desiredMovement)
@@ -101,16 +138,34 @@ void TransformComponent::move(const XMFLOAT3& desiredMovement)
 	auto mov = XMLoadFloat3(&desiredMovement);
 	auto newPos = XMVectorAdd(pos, mov);
 	XMStoreFloat3(&_position, newPos);
+	markDirty();
 	notify();
 }
 
 void TransformComponent::onAwake(Entity& e, const CComPtr<ID3D11Device>& device)
 {
+	TransformHierarchy::getInstance().add(this);
 	if (_parent) {
 		_parent->addObserver(weak_from_this());
 	}
 }
 
+void TransformComponent::saveState(StateWriter& writer) const
+{
+	writer.write(_position);
+	writer.write(_orientation);
+	writer.write(_scale);
+}
+
+void TransformComponent::loadState(StateReader& reader)
+{
+	reader.read(_position);
+	reader.read(_orientation);
+	reader.read(_scale);
+	markDirty();
+	notify();
+}
+
 void TransformComponent::deepCopy(const TransformComponent& tc)
 {
 	_position = tc._position;
@@ -121,6 +176,7 @@ void TransformComponent::deepCopy(const TransformComponent& tc)
 	_oScale = tc._oScale;
 	_transform = tc._transform;
 	_parent = tc._parent;
+	markDirty();
 }
 
 void TransformComponent::moveCopy(TransformComponent&& tc) noexcept
@@ -133,4 +189,5 @@ void TransformComponent::moveCopy(TransformComponent&& tc) noexcept
 	_oScale = tc._oScale;
 	_transform = tc._transform;
 	tc._parent.swap(_parent);
+	markDirty();
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <numeric>
+#include "Components/TransformComponent.h"
+
+using namespace DirectX;
+
+void TransformHierarchy::add(TransformComponent* transform)
+{
+	if (transform->_hierarchyIndex >= 0) return;
+	transform->_hierarchyIndex = static_cast<int32_t>(_transforms.size());
+	_transforms.push_back(transform);
+	_parents.push_back(-1);
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	_local.push_back(identity);
+	_world.push_back(identity);
+	_dirty.push_back(1);
+	_moved.push_back(0);
+	//Parent may not be registered yet, or may land after us; resolve order on next update.
+	_sorted = false;
+}
+
+void TransformHierarchy::remove(TransformComponent* transform)
+{
+	const int32_t index = transform->_hierarchyIndex;
+	if (index < 0) return;
+	const size_t last = _transforms.size() - 1;
+	if (static_cast<size_t>(index) != last) {
+		_transforms[index] = _transforms[last];
+		_parents[index] = _parents[last];
+		_local[index] = _local[last];
+		_world[index] = _world[last];
+		_dirty[index] = _dirty[last];
+		_transforms[index]->_hierarchyIndex = index;
+		_sorted = false;
+	}
+	_transforms.pop_back();
+	_parents.pop_back();
+	_local.pop_back();
+	_world.pop_back();
+	_dirty.pop_back();
+	_moved.pop_back();
+	transform->_hierarchyIndex = -1;
+}
+
+void TransformHierarchy::sort()
+{
+	const size_t count = _transforms.size();
+	std::vector<uint32_t> depth(count, 0);
+	for (size_t i = 0; i < count; ++i) {
+		for (auto p = _transforms[i]->_parent.get(); p && p->_hierarchyIndex >= 0; p = p->_parent.get())
+			++depth[i];
+	}
+	std::vector<uint32_t> order(count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) { return depth[a] < depth[b]; });
+
+	std::vector<TransformComponent*> transforms(count);
+	std::vector<XMFLOAT4X4> local(count), world(count);
+	for (size_t i = 0; i < count; ++i) {
+		transforms[i] = _transforms[order[i]];
+		local[i] = _local[order[i]];
+		world[i] = _world[order[i]];
+		transforms[i]->_hierarchyIndex = static_cast<int32_t>(i);
+	}
+	_transforms.swap(transforms);
+	_local.swap(local);
+	_world.swap(world);
+	for (size_t i = 0; i < count; ++i) {
+		const auto parent = _transforms[i]->_parent.get();
+		_parents[i] = parent ? parent->_hierarchyIndex : -1;
+	}
+	//Parent links may have changed, rebuild everything once.
+	std::fill(_dirty.begin(), _dirty.end(), 1);
+	_sorted = true;
+}
+
+void TransformHierarchy::update()
+{
+	if (!_sorted) sort();
+	for (size_t i = 0; i < _transforms.size(); ++i) {
+		const int32_t parent = _parents[i];
+		_moved[i] = _dirty[i] | (parent >= 0 ? _moved[parent] : 0);
+		if (!_moved[i]) continue;
+		if (_dirty[i]) XMStoreFloat4x4(&_local[i], _transforms[i]->getLocalAligned());
+		auto world = XMLoadFloat4x4(&_local[i]);
+		if (parent >= 0) world = XMMatrixMultiply(world, XMLoadFloat4x4(&_world[parent]));
+		XMStoreFloat4x4(&_world[i], world);
+		_dirty[i] = 0;
+	}
+}
@@ -0,0 +1,160 @@
+#include "TransformKernels.h"
+#include <intrin.h>
+#include <immintrin.h>
+
+using namespace DirectX;
+
+namespace {
+	//All matrices are row-major 4x4 floats. out = transpose(a * b).
+	void mulTransposeScalar(const float* a, const float* b, float* out) {
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				out[c * 4 + r] = a[r * 4] * b[c] + a[r * 4 + 1] * b[4 + c] + a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c];
+	}
+
+	void transposeScalar(const float* a, float* out) {
+		for (int r = 0; r < 4; ++r)
+			for (int c = 0; c < 4; ++c)
+				out[c * 4 + r] = a[r * 4 + c];
+	}
+
+	void kernelScalar(const XMFLOAT4X4* world, const size_t count, const XMFLOAT4X4& viewProj, DrawMatrices* out,
+		const XMFLOAT4X4* lightViewProjs, const size_t lightCount, XMFLOAT4X4* lightOut) {
+		for (size_t i = 0; i < count; ++i) {
+			const float* w = &world[i]._11;
+			transposeScalar(w, &out[i].m._11);
+			mulTransposeScalar(w, &viewProj._11, &out[i].mvp._11);
+			for (size_t l = 0; l < lightCount; ++l)
+				mulTransposeScalar(w, &lightViewProjs[l]._11, &lightOut[i * lightCount + l]._11);
+		}
+	}
+
+	//One row of a * b, with b's rows preloaded.
+	inline __m128 mulRowSSE(const float* aRow, const __m128 b0, const __m128 b1, const __m128 b2, const __m128 b3) {
+		const __m128 lo = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(aRow[0]), b0), _mm_mul_ps(_mm_set1_ps(aRow[1]), b1));
+		const __m128 hi = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(aRow[2]), b2), _mm_mul_ps(_mm_set1_ps(aRow[3]), b3));
+		return _mm_add_ps(lo, hi);
+	}
+
+	inline void storeTransposedSSE(__m128 r0, __m128 r1, __m128 r2, __m128 r3, float* out) {
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(out, r0);
+		_mm_storeu_ps(out + 4, r1);
+		_mm_storeu_ps(out + 8, r2);
+		_mm_storeu_ps(out + 12, r3);
+	}
+
+	inline void mulTransposeSSE(const float* a, const __m128* b, float* out) {
+		storeTransposedSSE(mulRowSSE(a, b[0], b[1], b[2], b[3]), mulRowSSE(a + 4, b[0], b[1], b[2], b[3]),
+			mulRowSSE(a + 8, b[0], b[1], b[2], b[3]), mulRowSSE(a + 12, b[0], b[1], b[2], b[3]), out);
+	}
+
+	void kernelSSE4(const XMFLOAT4X4* world, const size_t count, const XMFLOAT4X4& viewProj, DrawMatrices* out,
+		const XMFLOAT4X4* lightViewProjs, const size_t lightCount, XMFLOAT4X4* lightOut) {
+		const __m128 vp[4] = { _mm_loadu_ps(&viewProj._11), _mm_loadu_ps(&viewProj._21), _mm_loadu_ps(&viewProj._31), _mm_loadu_ps(&viewProj._41) };
+		for (size_t i = 0; i < count; ++i) {
+			const float* w = &world[i]._11;
+			storeTransposedSSE(_mm_loadu_ps(w), _mm_loadu_ps(w + 4), _mm_loadu_ps(w + 8), _mm_loadu_ps(w + 12), &out[i].m._11);
+			mulTransposeSSE(w, vp, &out[i].mvp._11);
+			for (size_t l = 0; l < lightCount; ++l) {
+				const float* lvp = &lightViewProjs[l]._11;
+				const __m128 light[4] = { _mm_loadu_ps(lvp), _mm_loadu_ps(lvp + 4), _mm_loadu_ps(lvp + 8), _mm_loadu_ps(lvp + 12) };
+				mulTransposeSSE(w, light, &lightOut[i * lightCount + l]._11);
+			}
+		}
+	}
+
+	//transpose(a * b) row c is sum over k of b[k][c] * column k of a, and a's columns are the rows of
+	//the transposed world we store anyway. Two output rows per 256-bit register, with the b factors
+	//splatted once per frame: coeffs[k * 2 + h] holds b[k][2h] in the low lane, b[k][2h + 1] in the high.
+	//Unlike a row-broadcast product this needs no shuffles, which bound the earlier AVX2 path.
+	void splatFactorsAVX2(const float* b, __m256* coeffs) {
+		for (int k = 0; k < 4; ++k)
+			for (int h = 0; h < 2; ++h)
+				coeffs[k * 2 + h] = _mm256_setr_m128(_mm_set1_ps(b[k * 4 + h * 2]), _mm_set1_ps(b[k * 4 + h * 2 + 1]));
+	}
+
+	inline void mulTransposeAVX2(const __m256* columns, const __m256* coeffs, float* out) {
+		for (int h = 0; h < 2; ++h) {
+			const __m256 lo = _mm256_fmadd_ps(columns[1], coeffs[2 + h], _mm256_mul_ps(columns[0], coeffs[h]));
+			const __m256 hi = _mm256_fmadd_ps(columns[3], coeffs[6 + h], _mm256_mul_ps(columns[2], coeffs[4 + h]));
+			_mm256_storeu_ps(out + h * 8, _mm256_add_ps(lo, hi));
+		}
+	}
+
+	void kernelAVX2(const XMFLOAT4X4* world, const size_t count, const XMFLOAT4X4& viewProj, DrawMatrices* out,
+		const XMFLOAT4X4* lightViewProjs, const size_t lightCount, XMFLOAT4X4* lightOut) {
+		__m256 vp[8];
+		splatFactorsAVX2(&viewProj._11, vp);
+		//Shadowed lights are few, more than fit here fall back to splatting per entity
+		constexpr size_t MAX_SPLATTED_LIGHTS = 4;
+		__m256 lights[MAX_SPLATTED_LIGHTS][8];
+		for (size_t l = 0; l < lightCount && l < MAX_SPLATTED_LIGHTS; ++l)
+			splatFactorsAVX2(&lightViewProjs[l]._11, lights[l]);
+		for (size_t i = 0; i < count; ++i) {
+			const float* w = &world[i]._11;
+			float* m = &out[i].m._11;
+			storeTransposedSSE(_mm_loadu_ps(w), _mm_loadu_ps(w + 4), _mm_loadu_ps(w + 8), _mm_loadu_ps(w + 12), m);
+			const __m256 columns[4] = { _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4)),
+				_mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12)) };
+			mulTransposeAVX2(columns, vp, &out[i].mvp._11);
+			for (size_t l = 0; l < lightCount; ++l) {
+				if (l < MAX_SPLATTED_LIGHTS) {
+					mulTransposeAVX2(columns, lights[l], &lightOut[i * lightCount + l]._11);
+					continue;
+				}
+				__m256 light[8];
+				splatFactorsAVX2(&lightViewProjs[l]._11, light);
+				mulTransposeAVX2(columns, light, &lightOut[i * lightCount + l]._11);
+			}
+		}
+	}
+}
+
+SimdLevel detectSimdLevel()
+{
+	static const SimdLevel level = [] {
+		int info[4] = {};
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+		if (maxLeaf < 1) return SimdLevel::Scalar;
+		__cpuid(info, 1);
+		const bool sse41 = (info[2] & (1 << 19)) != 0;
+		const bool fma = (info[2] & (1 << 12)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		bool avx2 = false;
+		if (maxLeaf >= 7 && osxsave && avx && fma) {
+			//OS must save the upper halves of the ymm registers
+			const bool ymmEnabled = (_xgetbv(0) & 0x6) == 0x6;
+			__cpuid(info, 7);
+			avx2 = ymmEnabled && (info[1] & (1 << 5)) != 0;
+		}
+		if (avx2) return SimdLevel::AVX2;
+		return sse41 ? SimdLevel::SSE4 : SimdLevel::Scalar;
+	}();
+	return level;
+}
+
+void computeDrawMatrices(const XMFLOAT4X4* world, const size_t count, const XMFLOAT4X4& viewProj, DrawMatrices* out,
+	const XMFLOAT4X4* lightViewProjs, const size_t lightCount, XMFLOAT4X4* lightOut)
+{
+	computeDrawMatrices(detectSimdLevel(), world, count, viewProj, out, lightViewProjs, lightCount, lightOut);
+}
+
+void computeDrawMatrices(const SimdLevel level, const XMFLOAT4X4* world, const size_t count, const XMFLOAT4X4& viewProj, DrawMatrices* out,
+	const XMFLOAT4X4* lightViewProjs, const size_t lightCount, XMFLOAT4X4* lightOut)
+{
+	const size_t lights = lightViewProjs && lightOut ? lightCount : 0;
+	switch (level) {
+	case SimdLevel::AVX2:
+		kernelAVX2(world, count, viewProj, out, lightViewProjs, lights, lightOut);
+		break;
+	case SimdLevel::SSE4:
+		kernelSSE4(world, count, viewProj, out, lightViewProjs, lights, lightOut);
+		break;
+	default:
+		kernelScalar(world, count, viewProj, out, lightViewProjs, lights, lightOut);
+		break;
+	}
+}
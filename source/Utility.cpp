@@ -133,4 +133,28 @@ void createGBuffer(const CComPtr<ID3D11Device>& d, const int w, const int h, Ren
     hr = d->CreateShaderResourceView(rt.getTexture(), &srvd, &rt.getSRV().p);
     if (FAILED(hr)) { throw std::exception("Failed to create Shader Resource View in GBuffer."); }
 
+}
+
+DirectX::XMFLOAT2 encodeOctahedral(const DirectX::XMFLOAT3& n)
+{
+    const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    float x = n.x / l1, y = n.y / l1;
+    if (n.z < 0) {
+        const float fx = (1.0f - std::fabs(y)) * (x >= 0 ? 1.0f : -1.0f);
+        const float fy = (1.0f - std::fabs(x)) * (y >= 0 ? 1.0f : -1.0f);
+        x = fx;
+        y = fy;
+    }
+    return DirectX::XMFLOAT2(x, y);
+}
+
+DirectX::XMFLOAT3 decodeOctahedral(const DirectX::XMFLOAT2& e)
+{
+    DirectX::XMFLOAT3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    //Unfold the lower hemisphere
+    const float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0 ? -t : t;
+    n.y += n.y >= 0 ? -t : t;
+    const float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+    return DirectX::XMFLOAT3(n.x / length, n.y / length, n.z / length);
 }
\ No newline at end of file
@@ -1,10 +1,32 @@
 #include "app.h"
 #include "Managers/ResourceManager.h"
 #include "Managers/CameraManager.h"
+#include "ArchetypeStore.h"
+#include "EntityRegistry.h"
+#include "ChangeQueue.h"
+#include "TransformHierarchy.h"
+#include "SceneArena.h"
+#include "AllocationCounter.h"
+#include "TrackedCBuffer.h"
+#include "Benchmarks.h"
 
 App::App(HWND& hwnd) : _hWnd(hwnd),
-	_d3dManager(std::make_shared<DirectX11Manager>(_hWnd)) {
-
+	_d3dManager(std::make_shared<DirectX11Manager>(_hWnd)),
+	_recorder(8 * 1024 * 1024, 1024, 2) {
+
+	//Must be created before the EntityRegistry so they outlive the entities they index/own.
+	SceneArena::getInstance();
+	ArchetypeStore::getInstance();
+	TransformHierarchy::getInstance();
+	//Destroyed components still flagged changed take themselves off the queue
+	ChangeQueue::getInstance();
+	auto& registry = EntityRegistry::getInstance();
+#ifdef RUN_BENCHMARKS
+	//Before any system registers a query, so the benchmark entities go unnoticed.
+	OutputDebugStringA(Benchmarks::format(Benchmarks::componentLookup(10000, 20)).c_str());
+	for (const size_t count : { 1000, 10000, 100000 })
+		OutputDebugStringA(Benchmarks::format(Benchmarks::drawMatrices(count, 20)).c_str());
+#endif
 	auto& resourceManager = ResourceManager::getInstance();
 	resourceManager.loadResourcesFromJson("RocketSimConfig.json", _d3dManager->getDevice(), _d3dManager->getContext());
 
@@ -15,6 +37,8 @@ App::App(HWND& hwnd) : _hWnd(hwnd),
 	//
 
 	//Setup d3d11 physics
+	//Neither declares its component access yet, so the scheduler runs them one after the other.
+	//They only overlap once their constructors call declareAccess.
 	_physicsSystem = std::make_shared<DirectX11Physics>();
 	_updateSystems.push_back(_physicsSystem);
 	_collisionSystem = std::make_shared<DirectX11Collision>(_d3dManager->getContext());
@@ -23,15 +47,22 @@ App::App(HWND& hwnd) : _hWnd(hwnd),
 
 	const auto& entities = resourceManager.getEntities();
 	//Awake all entities.
-	for (const auto& e : entities)
-		e->awake(_d3dManager->getDevice());
+	for (const auto handle : entities)
+		registry.get(handle)->awake(_d3dManager->getDevice());
+	TransformHierarchy::getInstance().update();
 
 	//Pass awoken entities to managers/systems
 	CameraManager::getInstance().onInit(entities);
-	for (const auto& s : _updateSystems)
+	for (const auto& s : _updateSystems) {
 		s->onInit(entities);
-	for (const auto& s : _renderSystems)
+		_updateScheduler.add(s);
+		_recorder.addSystem(s);
+		_commandBuffers.push_back(&s->getCommandBuffer());
+	}
+	for (const auto& s : _renderSystems) {
 		s->onInit(entities);
+		_commandBuffers.push_back(&s->getCommandBuffer());
+	}
 
 }
 
@@ -80,10 +111,18 @@ void App::onCamRotate(const int key)
 
 void App::run()
 {
+	AllocationCounter::beginFrame();
+	CBufferCounter::beginFrame();
 	Timer::getInstance().tick();
 
-	for (const auto& s : _updateSystems)
-		s->onAction();
+	_updateScheduler.run();
+	//Sync point: no system is iterating, apply everything they queued up this frame
+	CommandBuffer::playback(_commandBuffers, _d3dManager->getDevice());
+	//World matrices are rebuilt once, parents first, for whatever moved this frame
+	TransformHierarchy::getInstance().update();
+	//Observers (cameras, child transforms) see this frame's changes once, before anything draws
+	ChangeQueue::getInstance().flush();
+	_recorder.onFrame();
 
 	for (const auto& s : _renderSystems)
 		s->onAction();
@@ -99,3 +138,22 @@ void App::fireRocket()
 	_physicsSystem->fire();
 }
 
+bool App::rewind(const int frames, const bool allowPartial)
+{
+	if (_recorder.empty()) return false;
+	if (!_recorder.isComplete()) {
+		if (!allowPartial) {
+			OutputDebugStringA("[W] Rewind refused, some systems/components hold state the recorder doesn't capture.\n");
+			return false;
+		}
+		OutputDebugStringA("[W] Partial rewind, physics and particle state is not restored.\n");
+	}
+	const uint64_t newest = _recorder.getNewestFrame();
+	const uint64_t oldest = _recorder.getOldestFrame();
+	const uint64_t target = newest - oldest > static_cast<uint64_t>(frames) ? newest - frames : oldest;
+	if (!_recorder.restore(target)) return false;
+	TransformHierarchy::getInstance().update();
+	//Restored components have notified, let observers catch up before the next draw
+	ChangeQueue::getInstance().flush();
+	return true;
+}